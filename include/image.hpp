@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace MetaCore::Image {
+    /// @brief A view of RGBA32 pixels, which can be a section of a larger image
+    struct View {
+        uint8_t const* data = nullptr;
+        int width = 0;
+        int height = 0;
+        // in bytes, negative when flipped
+        int stride = 0;
+
+        uint8_t const* Row(int y) const { return data + y * stride; }
+        View Flipped() const { return {data + (height - 1) * stride, width, height, -stride}; }
+        View Crop(int x, int y, int width, int height) const { return {data + y * stride + x * 4, width, height, stride}; }
+    };
+
+    /// @brief An owned buffer of tightly packed RGBA32 pixels
+    struct Buffer {
+        Buffer() = default;
+        Buffer(int width, int height) : data(width * height * 4), width(width), height(height) {}
+
+        View GetView() const { return {data.data(), width, height, width * 4}; }
+        uint8_t* Row(int y) { return data.data() + y * width * 4; }
+
+        std::vector<uint8_t> data;
+        int width = 0;
+        int height = 0;
+    };
+
+    /// @brief Scales pixels to a new size in a single pass, averaging the covered area of each axis being downscaled and interpolating
+    /// bilinearly for each axis being upscaled
+    /// @param source The pixels to scale
+    /// @param width The width for the output
+    /// @param height The height for the output
+    /// @return The scaled pixels
+    Buffer Scale(View source, int width, int height);
+
+    /// @brief Encodes pixels as a PNG file, choosing a filter for each row
+    /// @param source The pixels to encode, from top to bottom
+    /// @param level The zlib compression level from 0 to 9, with higher levels being smaller but slower
+    /// @return The bytes of the PNG file
+    std::string EncodePNG(View source, int level);
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace MetaCore::Profiler {
+    // four buckets for each power of two nanoseconds, up to around 8 seconds
+    constexpr int BucketsPerOctave = 4;
+    constexpr int BucketCount = 33 * BucketsPerOctave;
+
+    extern std::atomic_bool enabled;
+
+    /// @brief Lock free counts of the durations of a hook, registered on creation
+    struct Histogram {
+        Histogram(char const* name);
+
+        void Record(uint64_t nanoseconds);
+
+        char const* const name;
+        std::atomic<uint32_t> buckets[BucketCount] = {};
+        std::atomic<uint64_t> total = 0;
+        std::atomic<uint64_t> max = 0;
+    };
+
+    /// @brief Records the time until it goes out of scope, if profiling was enabled when it was created
+    struct ScopedTimer {
+        using Clock = std::chrono::steady_clock;
+
+        ScopedTimer(Histogram& histogram) : histogram(enabled.load(std::memory_order_relaxed) ? &histogram : nullptr) {
+            if (this->histogram)
+                start = Clock::now();
+        }
+        ~ScopedTimer() {
+            if (histogram)
+                histogram->Record(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+        }
+
+        ScopedTimer(ScopedTimer const&) = delete;
+        ScopedTimer& operator=(ScopedTimer const&) = delete;
+
+       private:
+        Histogram* histogram;
+        Clock::time_point start;
+    };
+
+    /// @brief Logs the timings of all hooks, writes them to the dump file if set, and resets them
+    void Dump();
+}
+
+// times the rest of the current scope in a hook body, using the name of the hook
+#define PROFILE_HOOK()                                             \
+    static ::MetaCore::Profiler::Histogram hookHistogram_(name()); \
+    ::MetaCore::Profiler::ScopedTimer hookTimer_(hookHistogram_)
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "UnityEngine/Resources.hpp"
+#include "Zenject/DiContainer.hpp"
+#include "Zenject/SceneContext.hpp"
+#include "main.hpp"
+
+// finds singleton game objects from the scene containers they are bound in, instead of searching every loaded object
+class Services {
+   private:
+    // newest last, added as each scene context is installed
+    static inline std::vector<UnityW<Zenject::SceneContext>> contexts;
+    // increased with each installed context, to know when a search that found nothing is worth repeating
+    static inline int generation = 0;
+
+    template <class T>
+    static inline UnityW<T> instance;
+    template <class T>
+    static inline int searched = -1;
+
+   public:
+    static inline void AddContext(Zenject::SceneContext* context) {
+        std::erase_if(contexts, [context](auto const& existing) { return !existing || existing.unsafePtr() == context; });
+        contexts.emplace_back(context);
+        generation++;
+    }
+
+    // for instances that are seen before they would be searched for, such as in hooks
+    template <class T>
+    static inline void Capture(T* value) {
+        if (instance<T>.unsafePtr() != value)
+            instance<T> = value;
+    }
+
+    // gets a cached instance if it is still alive, otherwise resolves it from the newest scene that has it bound
+    template <class T>
+    static T* Get() {
+        if (instance<T>)
+            return instance<T>.unsafePtr();
+        for (auto context = contexts.rbegin(); context != contexts.rend(); context++) {
+            if (!*context || !(*context)->_container)
+                continue;
+            if (auto resolved = (*context)->_container->template TryResolve<T*>()) {
+                instance<T> = resolved;
+                return resolved;
+            }
+        }
+        // only for objects that aren't bound, or before any scene has been installed, and at most once per installed scene
+        if (searched<T> == generation)
+            return nullptr;
+        searched<T> = generation;
+        instance<T> = UnityEngine::Resources::FindObjectsOfTypeAll<T*>()->FirstOrDefault();
+        if (instance<T>)
+            logger.debug("found unbound {} by searching all objects", il2cpp_utils::ClassStandardName(classof(T*)));
+        return instance<T>.unsafePtr();
+    }
+};
@@ -2,10 +2,14 @@
 
 #include <queue>
 
+#include "System/Action_1.hpp"
+#include "System/Threading/Tasks/Task.hpp"
 #include "UnityEngine/EventSystems/IEventSystemHandler.hpp"
 #include "UnityEngine/EventSystems/IPointerUpHandler.hpp"
 #include "UnityEngine/MonoBehaviour.hpp"
+#include "custom-types/shared/delegate.hpp"
 #include "custom-types/shared/macros.hpp"
+#include "unity.hpp"
 
 #define UES UnityEngine::EventSystems
 
@@ -14,10 +18,12 @@ DECLARE_CLASS_CODEGEN(MetaCore, ObjectSignal, UnityEngine::MonoBehaviour) {
 
     DECLARE_INSTANCE_METHOD(void, OnEnable);
     DECLARE_INSTANCE_METHOD(void, OnDisable);
+    DECLARE_INSTANCE_METHOD(void, OnTransformChildrenChanged);
 
    public:
     std::function<void()> onEnable = nullptr;
     std::function<void()> onDisable = nullptr;
+    std::function<void()> onChildrenChanged = nullptr;
 
     static std::unordered_map<int, std::function<void()>> onDestroys;
 };
@@ -45,13 +51,23 @@ DECLARE_CLASS_CODEGEN(MetaCore, MainThreadScheduler, UnityEngine::MonoBehaviour)
     DECLARE_INSTANCE_METHOD(void, Update);
 
    public:
-    static void Schedule(std::function<void()> callback);
+    static void Schedule(std::function<void()> callback, MetaCore::Engine::Priority priority = MetaCore::Engine::Priority::UI);
     static void Schedule(std::function<bool()> wait, std::function<void()> callback);
-    static void AddUpdate(std::function<void()> callback);
+    static int AddUpdate(std::function<void()> callback, int frames = 1, float seconds = 0);
+    static void RemoveUpdate(int id);
+    static void SetUpdateTiming(bool enabled);
+    static std::vector<MetaCore::Engine::UpdateTiming> GetUpdateTimings();
+    static void SetBudget(float milliseconds);
+    static float GetDeferral();
 
     template <class T>
     static void Await(T task, std::function<void()> callback) {
-        Schedule([task]() { return task->IsCompleted; }, std::move(callback));
+        using Task = System::Threading::Tasks::Task;
+        // the continuation will run on a thread pool thread, so just use it to queue the callback
+        auto continuation = custom_types::MakeDelegate<System::Action_1<Task*>*>(std::function([callback = std::move(callback)](Task*) {
+            Schedule(callback);
+        }));
+        static_cast<Task*>(task)->ContinueWith(continuation);
     }
 };
 
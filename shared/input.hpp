@@ -2,6 +2,7 @@
 
 #include "UnityEngine/Pose.hpp"
 #include "UnityEngine/Vector2.hpp"
+#include "UnityEngine/Vector3.hpp"
 #include "VRUIControls/VRInputModule.hpp"
 #include "export.h"
 
@@ -44,7 +45,7 @@ namespace MetaCore::Input {
         Either,
     };
 
-    /// @brief Gets if a button is currently pressed for a given controller
+    /// @brief Gets if a button is currently pressed for a given controller, using the state read once per frame for all except Active
     /// @param controller The controller to check the button state for
     /// @param button The button to check
     /// @return If the button is pressed on the controller
@@ -59,21 +60,113 @@ namespace MetaCore::Input {
     /// @return The 2-dimensional thumbstick position with axes from -1 to 1
     METACORE_EXPORT UnityEngine::Vector2 GetThumbstick(Controllers controller);
 
-    /// @brief The string identifier that maps the Buttons enum to events run when they are pressed, when used in the "mod" parameter
+    /// @brief The string identifier that maps the Buttons enum to events run when they are pressed on either controller, when used in the "mod"
+    /// parameter, or with ButtonEvent for a specific controller
     std::string const PressEvents = "MetaCoreButtonPresses";
-    /// @brief The string identifier that maps the Buttons enum to events run when they are released, when used in the "mod" parameter
+    /// @brief The string identifier that maps the Buttons enum to events run when they are released on either controller, when used in the "mod"
+    /// parameter, or with ButtonEvent for a specific controller
     std::string const ReleaseEvents = "MetaCoreButtonReleases";
-    /// @brief The string identifier that maps the Buttons enum to events run every frame they are held, when used in the "mod" parameter
+    /// @brief The string identifier that maps the Buttons enum to events run every frame they are held on either controller, when used in the
+    /// "mod" parameter, or with ButtonEvent for a specific controller
     std::string const HoldEvents = "MetaCoreButtonHolds";
 
-    /// @brief Gets the current position and rotation of a controller
+    /// @brief The string identifier that maps the Buttons enum to events run when they are pressed twice in quick succession, when used in the
+    /// "mod" parameter, or with ButtonEvent for a specific controller
+    std::string const DoubleTapEvents = "MetaCoreButtonDoubleTaps";
+    /// @brief The string identifier that maps the Buttons enum to events run once when they have been held for a while, when used in the "mod"
+    /// parameter, or with ButtonEvent for a specific controller
+    std::string const LongPressEvents = "MetaCoreButtonLongPresses";
+    /// @brief The string identifier for events registered with RegisterChord
+    std::string const ChordEvents = "MetaCoreButtonChords";
+
+    /// @brief Gets the per-mod id of the events for a button on a specific controller, for use with PressEvents, ReleaseEvents, HoldEvents,
+    /// DoubleTapEvents, and LongPressEvents
+    /// @param controller The controller for the events, which can be Left, Right, or Either
+    /// @param button The button for the events
+    /// @return The per-mod id of the events, which is the button itself for Either, or -1 for Active
+    constexpr int ButtonEvent(Controllers controller, Buttons button) {
+        switch (controller) {
+            case Left:
+                return ButtonsMax + 1 + button;
+            case Right:
+                return (ButtonsMax + 1) * 2 + button;
+            case Either:
+                return button;
+            default:
+                return -1;
+        }
+    }
+
+    /// @brief A change in the state of a button
+    struct ButtonEdge {
+        // If the button was pressed, otherwise it was released
+        bool pressed;
+        // The unscaled time of the frame the change was read in
+        float time;
+    };
+
+    /// @brief Gets the most recent presses and releases of a button, up to eight
+    /// @param controller The controller to check the button history for, which can be Left, Right, or Either
+    /// @param button The button to check
+    /// @return The recent changes to the button, oldest first
+    METACORE_EXPORT std::vector<ButtonEdge> GetButtonHistory(Controllers controller, Buttons button);
+    /// @brief Gets how long a button has been held
+    /// @param controller The controller to check the button state for, which can be Left, Right, or Either
+    /// @param button The button to check
+    /// @return The time in seconds since the button was pressed, or 0 if it is not pressed
+    METACORE_EXPORT float GetHeldTime(Controllers controller, Buttons button);
+    /// @brief Sets the timing used for DoubleTapEvents and LongPressEvents, which is shared between all mods
+    /// @param doubleTapSeconds The maximum time between the presses of a double tap, 0.3 by default
+    /// @param longPressSeconds The time a button needs to be held for a long press, 0.5 by default
+    METACORE_EXPORT void SetGestureTiming(float doubleTapSeconds, float longPressSeconds);
+    /// @brief Registers an event run when a combination of buttons becomes held on a controller, such as the grip and trigger together
+    /// @param controller The controller for the combination, which can be Left, Right, or Either. For Either, the buttons can be on either hand
+    /// @param buttons The buttons in the combination, at least two
+    /// @param window The maximum time in seconds between the first and last press of the combination, or 0 for no limit
+    /// @return The global id of the event, shared with identical combinations, or -1 on failure
+    METACORE_EXPORT int RegisterChord(Controllers controller, std::vector<Buttons> buttons, float window = 0);
+
+    enum Nodes {
+        // The left hand controller
+        LeftHand,
+        // The right hand controller
+        RightHand,
+        // The headset
+        Head,
+    };
+
+    /// @brief A tracked pose from a single frame
+    struct PoseSample {
+        UnityEngine::Pose pose;
+        // The unscaled time of the frame the pose was read in
+        float time;
+    };
+
+    /// @brief Gets the current position and rotation of a controller, which is only read once per frame
     /// @param left If the left controller should be returned, otherwise the right controller
     /// @return The tracked pose of the controller
     METACORE_EXPORT UnityEngine::Pose GetHandPose(bool left);
-    /// @brief Gets the current position and rotation of the headset
+    /// @brief Gets the current position and rotation of the headset, which is only read once per frame
     /// @return The tracked pose of the headset
     METACORE_EXPORT UnityEngine::Pose GetHeadPose();
 
+    /// @brief Requests that a history of poses be recorded every frame. The longest length requested by any mod will be used
+    /// @param mod The unique id of the mod requesting the history
+    /// @param frames The number of frames to keep, up to 512, or 0 to remove the request
+    METACORE_EXPORT void SetPoseHistory(std::string mod, int frames);
+    /// @brief Gets the recorded history of poses for a tracked node, only available if requested with SetPoseHistory
+    /// @param node The tracked node to get the history for
+    /// @return The poses from recent frames, oldest first
+    METACORE_EXPORT std::vector<PoseSample> GetPoseHistory(Nodes node);
+    /// @brief Estimates the velocity of a tracked node from its recent poses, only available if requested with SetPoseHistory
+    /// @param node The tracked node to get the velocity of
+    /// @return The world space velocity in units per second, or zero if there is not enough history
+    METACORE_EXPORT UnityEngine::Vector3 GetVelocity(Nodes node);
+    /// @brief Estimates the angular velocity of a tracked node from its recent poses, only available if requested with SetPoseHistory
+    /// @param node The tracked node to get the angular velocity of
+    /// @return The world space rotation axis scaled by the speed in radians per second, or zero if there is not enough history
+    METACORE_EXPORT UnityEngine::Vector3 GetAngularVelocity(Nodes node);
+
     /// @brief Finds the currently active VRInputModule if any
     /// @return The currently active VRInputModule, or nullptr if none can be found
     METACORE_EXPORT VRUIControls::VRInputModule* GetCurrentInputModule();
@@ -15,6 +15,7 @@
 #include "GlobalNamespace/ScoreController.hpp"
 #include "UnityEngine/Camera.hpp"
 #include "UnityEngine/Quaternion.hpp"
+#include "Zenject/DiContainer.hpp"
 #include "export.h"
 
 // no per-variable documentation here, sorry
@@ -99,7 +100,9 @@ namespace MetaCore::Internals {
     METACORE_EXPORT extern bool mapWasRestarted;
 
     METACORE_EXPORT void Initialize();
+    METACORE_EXPORT void Initialize(Zenject::DiContainer* container);
     METACORE_EXPORT void DoSlowUpdate();
+    METACORE_EXPORT void UpdateInput();
     METACORE_EXPORT void Finish(bool quit, bool restart);
 
     METACORE_EXPORT extern GlobalNamespace::BeatmapKey selectedKey;
@@ -1,5 +1,10 @@
 #pragma once
 
+#include <atomic>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+
 #include "export.h"
 #include "jutils.hpp"
 
@@ -24,10 +29,114 @@ namespace MetaCore::Java {
         JNIEnv* env;
     };
 
-    /// @brief Gets a JNIEnv instance for the current thread - should be called as little as possible
-    /// @return The JNIEnv instance for the thread
+    /// @brief A view of the contents of a java primitive array without copying, released when destroyed
+    /// @tparam T The c++ element type, such as uint8_t for byte[] or float for float[]
+    /// @note No other JNI functions can be used while the view exists, and it should not be held for long as it can block garbage collection
+    template <class T>
+    struct CriticalArray {
+        /// @brief Constructor that gets the contents of the array
+        /// @param env The JNIEnv instance for the thread
+        /// @param array The java primitive array
+        /// @param readOnly If changes to the contents can be discarded instead of copied back, in case the java runtime made a copy
+        CriticalArray(JNIEnv* env, jarray array, bool readOnly = false) : env(env), array(array), readOnly(readOnly) {
+            if (!array)
+                return;
+            size_t size = env->GetArrayLength(array);
+            data = {(T*) env->GetPrimitiveArrayCritical(array, nullptr), size};
+            if (!data.data())
+                data = {};
+        }
+        CriticalArray(CriticalArray const&) = delete;
+        /// @brief Destructor that releases the contents if not already released
+        ~CriticalArray() { release(); }
+
+        /// @brief Releases the contents if not already released, after which the view is empty
+        void release() {
+            if (data.data())
+                env->ReleasePrimitiveArrayCritical(array, data.data(), readOnly ? JNI_ABORT : 0);
+            data = {};
+        }
+
+        std::span<T> span() const { return data; }
+        T* begin() const { return data.data(); }
+        T* end() const { return data.data() + data.size(); }
+        size_t size() const { return data.size(); }
+        T& operator[](size_t index) const { return data[index]; }
+
+       private:
+        JNIEnv* env;
+        jarray array;
+        bool readOnly;
+        std::span<T> data = {};
+    };
+
+    /// @brief A view of the modified UTF-8 characters of a java string, released when destroyed
+    struct StringChars {
+        /// @brief Constructor that gets the characters of the string
+        /// @param env The JNIEnv instance for the thread
+        /// @param string The java string object
+        StringChars(JNIEnv* env, jstring string) : env(env), string(string) {
+            if (!string)
+                return;
+            char const* chars = env->GetStringUTFChars(string, nullptr);
+            if (chars)
+                data = {chars, (size_t) env->GetStringUTFLength(string)};
+        }
+        StringChars(StringChars const&) = delete;
+        /// @brief Destructor that releases the characters
+        ~StringChars() {
+            if (data.data())
+                env->ReleaseStringUTFChars(string, data.data());
+        }
+
+        std::string_view view() const { return data; }
+        operator std::string_view() const { return data; }
+
+       private:
+        JNIEnv* env;
+        jstring string;
+        std::string_view data = {};
+    };
+
+    /// @brief A view of the UTF-16 characters of a java string without copying, released when destroyed
+    /// @note No other JNI functions can be used while the view exists
+    struct CriticalString {
+        /// @brief Constructor that gets the characters of the string
+        /// @param env The JNIEnv instance for the thread
+        /// @param string The java string object
+        CriticalString(JNIEnv* env, jstring string) : env(env), string(string) {
+            if (!string)
+                return;
+            size_t length = env->GetStringLength(string);
+            auto chars = (char16_t const*) env->GetStringCritical(string, nullptr);
+            if (chars)
+                data = {chars, length};
+        }
+        CriticalString(CriticalString const&) = delete;
+        /// @brief Destructor that releases the characters
+        ~CriticalString() {
+            if (data.data())
+                env->ReleaseStringCritical(string, (jchar const*) data.data());
+        }
+
+        std::u16string_view view() const { return data; }
+        operator std::u16string_view() const { return data; }
+
+       private:
+        JNIEnv* env;
+        jstring string;
+        std::u16string_view data = {};
+    };
+
+    /// @brief Gets a JNIEnv instance for the current thread, attaching it on the first call and detaching it when the thread exits
+    /// @return The JNIEnv instance for the thread, or nullptr if attaching failed
+    /// @note The instance is cached per thread after the first call, so it is cheap to call repeatedly
     METACORE_EXPORT JNIEnv* GetEnv();
 
+    /// @brief Clears and rethrows a pending java exception as a std::runtime_error, if there is one
+    /// @param env The JNIEnv instance for the thread
+    METACORE_EXPORT void CheckException(JNIEnv* env);
+
     /// @brief Creates a new instance of the provided java class
     /// @param env The JNIEnv instance for the thread
     /// @param clazz The information to find the class of the method
@@ -77,6 +186,24 @@ namespace MetaCore::Java {
     /// @return A global ref to the newly loaded class
     METACORE_EXPORT jclass LoadClass(JNIEnv* env, std::string name, std::string_view dexBytes);
 
+    /// @brief Creates a java direct ByteBuffer using native memory without copying
+    /// @param env The JNIEnv instance for the thread
+    /// @param data The native memory, which must stay valid for as long as the buffer is used
+    /// @return The java ByteBuffer object, or nullptr if direct buffers are unsupported
+    METACORE_EXPORT jobject NewDirectBuffer(JNIEnv* env, std::span<uint8_t> data);
+
+    /// @brief Gets the native memory of a java direct ByteBuffer without copying
+    /// @param env The JNIEnv instance for the thread
+    /// @param buffer The java ByteBuffer object
+    /// @return The memory of the buffer, or an empty span if it is not a direct buffer
+    METACORE_EXPORT std::span<uint8_t> GetDirectBuffer(JNIEnv* env, jobject buffer);
+
+    /// @brief Creates a java byte array with a single bulk copy of native memory
+    /// @param env The JNIEnv instance for the thread
+    /// @param data The bytes to copy
+    /// @return The java byte array
+    METACORE_EXPORT jbyteArray NewByteArray(JNIEnv* env, std::span<uint8_t const> data);
+
     /// @brief Gets the c++ string version of a java string object
     /// @param env The JNIEnv instance for the thread
     /// @param string The java string object
@@ -101,6 +228,176 @@ namespace MetaCore::Java {
     /// @return The description of the exception
     METACORE_EXPORT std::string DescribeError(JNIEnv* env, jthrowable error);
 
+    /// @brief The shared state of typed method handles, resolving the class and method id on first use
+    struct MethodHandle {
+        MethodHandle(std::string className, std::string name) : className(std::move(className)), name(std::move(name)) {}
+
+        /// @brief Finds the class and method id if not already found
+        /// @param env The JNIEnv instance for the thread
+        /// @param signature The signature of the method
+        /// @param isStatic If the method is static
+        /// @return If the method was found
+        METACORE_EXPORT bool Resolve(JNIEnv* env, std::string_view signature, bool isStatic);
+
+        std::string const className;
+        std::string const name;
+        std::atomic<jclass> clazz = nullptr;
+        std::atomic<jmethodID> id = nullptr;
+    };
+
+    namespace Impl {
+        template <class T>
+        jvalue ToValue(T value) {
+            jvalue ret;
+            if constexpr (std::is_same_v<T, bool>)
+                ret.z = value;
+            else if constexpr (std::is_integral_v<T> && sizeof(T) == 1)
+                ret.b = value;
+            else if constexpr (std::is_same_v<T, uint16_t>)
+                ret.c = value;
+            else if constexpr (std::is_same_v<T, short>)
+                ret.s = value;
+            else if constexpr (std::is_same_v<T, int>)
+                ret.i = value;
+            else if constexpr (std::is_same_v<T, long>)
+                ret.j = value;
+            else if constexpr (std::is_same_v<T, float>)
+                ret.f = value;
+            else if constexpr (std::is_same_v<T, double>)
+                ret.d = value;
+            else
+                ret.l = (jobject) value;
+            return ret;
+        }
+
+#define CALL_METHOD(prefix, target)                                              \
+    if constexpr (std::is_same_v<R, void>)                                       \
+        env->prefix##VoidMethodA(target, method, args);                          \
+    else if constexpr (std::is_same_v<R, bool>)                                  \
+        return env->prefix##BooleanMethodA(target, method, args) == JNI_TRUE;    \
+    else if constexpr (std::is_integral_v<R> && sizeof(R) == 1)                  \
+        return (R) env->prefix##ByteMethodA(target, method, args);               \
+    else if constexpr (std::is_same_v<R, uint16_t>)                              \
+        return env->prefix##CharMethodA(target, method, args);                   \
+    else if constexpr (std::is_same_v<R, short>)                                 \
+        return env->prefix##ShortMethodA(target, method, args);                  \
+    else if constexpr (std::is_same_v<R, int>)                                   \
+        return env->prefix##IntMethodA(target, method, args);                    \
+    else if constexpr (std::is_same_v<R, long>)                                  \
+        return env->prefix##LongMethodA(target, method, args);                   \
+    else if constexpr (std::is_same_v<R, float>)                                 \
+        return env->prefix##FloatMethodA(target, method, args);                  \
+    else if constexpr (std::is_same_v<R, double>)                                \
+        return env->prefix##DoubleMethodA(target, method, args);                 \
+    else                                                                         \
+        return (R) env->prefix##ObjectMethodA(target, method, args)
+
+        template <class R>
+        R CallMethod(JNIEnv* env, jobject instance, jmethodID method, jvalue const* args) {
+            CALL_METHOD(Call, instance);
+        }
+
+        template <class R>
+        R CallStaticMethod(JNIEnv* env, jclass clazz, jmethodID method, jvalue const* args) {
+            CALL_METHOD(CallStatic, clazz);
+        }
+
+#undef CALL_METHOD
+
+        template <class R, class F>
+        R CallChecked(JNIEnv* env, F call) {
+            if constexpr (std::is_same_v<R, void>) {
+                call();
+                CheckException(env);
+            } else {
+                R ret = call();
+                CheckException(env);
+                return ret;
+            }
+        }
+    }
+
+    template <class T>
+    struct JavaMethod;
+
+    /// @brief A handle to a java instance method, with the signature generated from its c++ type and the id found only once
+    /// @tparam R The c++ return type of the method
+    /// @tparam TArgs The c++ argument types of the method
+    template <class R, class... TArgs>
+    struct JavaMethod<R(TArgs...)> : MethodHandle {
+        static constexpr auto Signature = MethodSignature<R(TArgs...)>;
+
+        /// @brief Constructor for a method, which will not be found until it is first run
+        /// @param className The name of the class declaring the method, such as "java/lang/Object"
+        /// @param name The name of the method
+        JavaMethod(std::string className, std::string name) : MethodHandle(std::move(className), std::move(name)) {}
+
+        /// @brief Runs the method on a java object
+        /// @param env The JNIEnv instance for the thread
+        /// @param instance The java object, which must be an instance of the class
+        /// @param args The arguments for the method
+        /// @return The return value of the method
+        R operator()(JNIEnv* env, jobject instance, TArgs... args) {
+            if (!Resolve(env, Signature, false))
+                throw std::runtime_error("Java method " + name + " not found in " + className);
+            jvalue values[sizeof...(TArgs) + 1] = {Impl::ToValue(args)...};
+            return Impl::CallChecked<R>(env, [&]() { return Impl::CallMethod<R>(env, instance, id.load(std::memory_order_relaxed), values); });
+        }
+    };
+
+    template <class T>
+    struct JavaStaticMethod;
+
+    /// @brief A handle to a java static method, with the signature generated from its c++ type and the id found only once
+    /// @tparam R The c++ return type of the method
+    /// @tparam TArgs The c++ argument types of the method
+    template <class R, class... TArgs>
+    struct JavaStaticMethod<R(TArgs...)> : MethodHandle {
+        static constexpr auto Signature = MethodSignature<R(TArgs...)>;
+
+        /// @brief Constructor for a method, which will not be found until it is first run
+        /// @param className The name of the class declaring the method
+        /// @param name The name of the method
+        JavaStaticMethod(std::string className, std::string name) : MethodHandle(std::move(className), std::move(name)) {}
+
+        /// @brief Runs the static method
+        /// @param env The JNIEnv instance for the thread
+        /// @param args The arguments for the method
+        /// @return The return value of the method
+        R operator()(JNIEnv* env, TArgs... args) {
+            if (!Resolve(env, Signature, true))
+                throw std::runtime_error("Java method " + name + " not found in " + className);
+            jvalue values[sizeof...(TArgs) + 1] = {Impl::ToValue(args)...};
+            return Impl::CallChecked<R>(env, [&]() {
+                return Impl::CallStaticMethod<R>(env, clazz.load(std::memory_order_relaxed), id.load(std::memory_order_relaxed), values);
+            });
+        }
+    };
+
+    /// @brief A handle to a java constructor, with the signature generated from its c++ argument types and the id found only once
+    /// @tparam TArgs The c++ argument types of the constructor
+    template <class... TArgs>
+    struct JavaConstructor : MethodHandle {
+        static constexpr auto Signature = MethodSignature<void(TArgs...)>;
+
+        /// @brief Constructor for a java class constructor, which will not be found until it is first run
+        /// @param className The name of the class to create
+        JavaConstructor(std::string className) : MethodHandle(std::move(className), "<init>") {}
+
+        /// @brief Creates a new instance of the class
+        /// @param env The JNIEnv instance for the thread
+        /// @param args The arguments for the constructor
+        /// @return The created java class instance
+        jobject operator()(JNIEnv* env, TArgs... args) {
+            if (!Resolve(env, Signature, false))
+                throw std::runtime_error("Java constructor not found in " + className);
+            jvalue values[sizeof...(TArgs) + 1] = {Impl::ToValue(args)...};
+            return Impl::CallChecked<jobject>(env, [&]() {
+                return env->NewObjectA(clazz.load(std::memory_order_relaxed), id.load(std::memory_order_relaxed), values);
+            });
+        }
+    };
+
 #define SPECIALIZATION(type)                                                                                \
     extern template METACORE_EXPORT type RunMethod(JNIEnv* env, FindClass clazz, FindMethodID method, ...); \
     extern template METACORE_EXPORT type GetField(JNIEnv* env, FindClass clazz, FindFieldID field);         \
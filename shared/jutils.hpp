@@ -2,7 +2,10 @@
 
 #include <jni.h>
 
+#include <algorithm>
+#include <cstdint>
 #include <string>
+#include <string_view>
 
 #include "export.h"
 
@@ -23,9 +26,109 @@ class:            "Lclass;"
 For example, a method that takes a String and two floats and returns an int would have the signature:
 "(Ljava/Lang/String;FF)I"
 Notably class names in JNI are also different - instead of "." they use "/", or "$" for nested types.
+Signatures can also be generated at compile time from c++ types with MethodSignature, using JavaObject for other classes:
+MethodSignature<int(jstring, float, float)> == "(Ljava/lang/String;FF)I"
 */
 
 namespace MetaCore::Java {
+    /// @brief A string that can be used as a template argument and concatenated at compile time
+    /// @tparam N The size of the string including its null terminator
+    template <size_t N>
+    struct Literal {
+        constexpr Literal() = default;
+        constexpr Literal(char const (&string)[N]) { std::copy_n(string, N, value); }
+
+        static constexpr size_t size = N - 1;
+        constexpr char const* c_str() const { return value; }
+        constexpr std::string_view view() const { return {value, size}; }
+        constexpr operator std::string_view() const { return view(); }
+
+        char value[N] = {};
+    };
+
+    /// @brief Concatenates multiple Literals at compile time
+    /// @tparam Parts The Literals to concatenate in order
+    /// @return The concatenated Literal
+    template <Literal... Parts>
+    constexpr auto Concat() {
+        Literal<(Parts.size + ... + 0) + 1> ret;
+        size_t index = 0;
+        ((std::copy_n(Parts.value, Parts.size, ret.value + index), index += Parts.size), ...);
+        return ret;
+    }
+
+    /// @brief A java object of a specific class, for use in generated signatures
+    /// @tparam Name The JNI name of the class, such as "java/nio/ByteBuffer"
+    template <Literal Name>
+    struct JavaObject {
+        static constexpr auto ClassName = Name;
+
+        JavaObject(jobject object = nullptr) : object(object) {}
+        operator jobject() const { return object; }
+
+        jobject object;
+    };
+
+    /// @brief The JNI signature of a c++ type, undefined for types that can't be converted
+    template <class T>
+    struct TypeSignature;
+
+#define TYPE_SIGNATURE(type, signature)                   \
+    template <>                                           \
+    struct TypeSignature<type> {                          \
+        static constexpr auto value = Literal(signature); \
+    }
+
+    TYPE_SIGNATURE(void, "V");
+    TYPE_SIGNATURE(bool, "Z");
+    TYPE_SIGNATURE(int8_t, "B");
+    TYPE_SIGNATURE(uint8_t, "B");
+    TYPE_SIGNATURE(char, "B");
+    TYPE_SIGNATURE(uint16_t, "C");
+    TYPE_SIGNATURE(short, "S");
+    TYPE_SIGNATURE(int, "I");
+    TYPE_SIGNATURE(long, "J");
+    TYPE_SIGNATURE(float, "F");
+    TYPE_SIGNATURE(double, "D");
+    TYPE_SIGNATURE(jobject, "Ljava/lang/Object;");
+    TYPE_SIGNATURE(jstring, "Ljava/lang/String;");
+    TYPE_SIGNATURE(jclass, "Ljava/lang/Class;");
+    TYPE_SIGNATURE(jthrowable, "Ljava/lang/Throwable;");
+    TYPE_SIGNATURE(jbooleanArray, "[Z");
+    TYPE_SIGNATURE(jbyteArray, "[B");
+    TYPE_SIGNATURE(jcharArray, "[C");
+    TYPE_SIGNATURE(jshortArray, "[S");
+    TYPE_SIGNATURE(jintArray, "[I");
+    TYPE_SIGNATURE(jlongArray, "[J");
+    TYPE_SIGNATURE(jfloatArray, "[F");
+    TYPE_SIGNATURE(jdoubleArray, "[D");
+    TYPE_SIGNATURE(jobjectArray, "[Ljava/lang/Object;");
+
+#undef TYPE_SIGNATURE
+
+    template <Literal Name>
+    struct TypeSignature<JavaObject<Name>> {
+        static constexpr auto value = Concat<Literal("L"), Name, Literal(";")>();
+    };
+
+    template <class T>
+    struct MethodSignatureImpl;
+
+    template <class R, class... TArgs>
+    struct MethodSignatureImpl<R(TArgs...)> {
+        static constexpr auto value = Concat<Literal("("), TypeSignature<TArgs>::value..., Literal(")"), TypeSignature<R>::value>();
+    };
+
+    /// @brief The JNI signature of a c++ type
+    /// @tparam T The c++ type
+    template <class T>
+    constexpr auto FieldSignature = TypeSignature<T>::value;
+
+    /// @brief The JNI signature of a c++ function type
+    /// @tparam T The c++ function type, such as int(jstring, float)
+    template <class T>
+    constexpr auto MethodSignature = MethodSignatureImpl<T>::value;
+
     /// @brief A struct that holds information to find a java class
     struct FindClass {
         jclass clazz = nullptr;
@@ -78,17 +181,20 @@ namespace MetaCore::Java {
     /// @param env The JNIEnv instance for the thread
     /// @param clazz The information to find the class
     /// @return The java class if found, otherwise nullptr
+    /// @note Classes found by name are cached as global refs and should not be deleted, but classes of instances are new local refs
     METACORE_EXPORT jclass GetClass(JNIEnv* env, FindClass clazz);
     /// @brief Gets the java method id for a FindMethodID
     /// @param env The JNIEnv instance for the thread
     /// @param clazz The information to find the class of the method
     /// @param method The information to find the method
     /// @return The java method id if found, otherwise nullptr
+    /// @note Method ids are cached after the first lookup, so repeated calls are cheap
     METACORE_EXPORT jmethodID GetMethodID(JNIEnv* env, FindClass clazz, FindMethodID method);
     /// @brief Gets the java field id for a FindFieldID
     /// @param env The JNIEnv instance for the thread
     /// @param clazz The information to find the class of the field
     /// @param method The information to find the field
     /// @return The java field id if found, otherwise nullptr
+    /// @note Field ids are cached after the first lookup, so repeated calls are cheap
     METACORE_EXPORT jfieldID GetFieldID(JNIEnv* env, FindClass clazz, FindFieldID field);
 }
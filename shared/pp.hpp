@@ -4,6 +4,7 @@
 #include "GlobalNamespace/GameplayModifiers.hpp"
 #include "export.h"
 #include "rapidjson-macros/shared/macros.hpp"
+#include "tasks.hpp"
 
 namespace MetaCore::PP {
     /// @brief The BeatLeader ratings for speed-changing modifiers specifically
@@ -41,6 +42,9 @@ namespace MetaCore::PP {
     /// @brief ScoreSaber ranking information for a specific characteristic/difficulty of a map (just a star rating)
     using SSSongDiff = float;
 
+    /// @brief The available BeatLeader and ScoreSaber ranking information for a map characteristic/difficulty
+    using MapInfo = std::pair<std::optional<BLSongDiff>, std::optional<SSSongDiff>>;
+
     /// @brief The acc to PP calculation cure for BeatLeader
     METACORE_EXPORT extern std::vector<std::pair<double, double>> const BeatLeaderCurve;
     /// @brief The acc to PP calculation cure for ScoreSaber
@@ -85,5 +89,7 @@ namespace MetaCore::PP {
     /// @brief Finds the BeatLeader and ScoreSaber ranking information for a given map characteristic/difficulty
     /// @param map The map characteristic/difficulty to query
     /// @param callback A callback called with the available ranking info once found
-    METACORE_EXPORT void GetMapInfo(GlobalNamespace::BeatmapKey map, std::function<void(std::optional<BLSongDiff>, std::optional<SSSongDiff>)> callback);
+    /// @return The task for the ranking info, which will skip parsing responses if all requests for the map are cancelled
+    METACORE_EXPORT Task<MapInfo>
+    GetMapInfo(GlobalNamespace::BeatmapKey map, std::function<void(std::optional<BLSongDiff>, std::optional<SSSongDiff>)> callback = nullptr);
 }
@@ -1,13 +1,78 @@
 #pragma once
 
+#include <array>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <string_view>
+
 #include "GlobalNamespace/BeatmapKey.hpp"
 #include "GlobalNamespace/BeatmapLevel.hpp"
 #include "GlobalNamespace/BeatmapLevelPack.hpp"
 #include "GlobalNamespace/IReadonlyBeatmapData.hpp"
 #include "UnityEngine/Sprite.hpp"
 #include "export.h"
+#include "tasks.hpp"
 
 namespace MetaCore::Songs {
+    /// @brief The binary form of a custom level hash, for use as a cheap map key instead of the 40 character string
+    struct Hash {
+        std::array<uint8_t, 20> bytes = {};
+
+        /// @brief Parses a hash from its hex representation, ignoring case
+        /// @param hex The hex string, which must be exactly 40 characters
+        /// @return The parsed hash, or nullopt if the string was not a valid hash
+        static constexpr std::optional<Hash> Parse(std::string_view hex);
+
+        /// @brief Converts the hash back to its (uppercase) hex representation
+        /// @return The hex string of the hash
+        METACORE_EXPORT std::string ToString() const;
+
+        constexpr bool operator==(Hash const&) const = default;
+        constexpr auto operator<=>(Hash const&) const = default;
+    };
+
+    namespace HashImpl {
+        // -1 for any character that isn't a hex digit
+        constexpr auto HexValues = []() {
+            std::array<int8_t, 256> ret;
+            ret.fill(-1);
+            for (int i = 0; i < 10; i++)
+                ret['0' + i] = i;
+            for (int i = 0; i < 6; i++) {
+                ret['a' + i] = 10 + i;
+                ret['A' + i] = 10 + i;
+            }
+            return ret;
+        }();
+    }
+
+    constexpr std::optional<Hash> Hash::Parse(std::string_view hex) {
+        Hash ret;
+        if (hex.size() != ret.bytes.size() * 2)
+            return std::nullopt;
+        int invalid = 0;
+        for (size_t i = 0; i < ret.bytes.size(); i++) {
+            int high = HashImpl::HexValues[(unsigned char) hex[i * 2]];
+            int low = HashImpl::HexValues[(unsigned char) hex[i * 2 + 1]];
+            // check once at the end instead of branching per byte
+            invalid |= high | low;
+            ret.bytes[i] = (high << 4) | (low & 0xf);
+        }
+        if (invalid < 0)
+            return std::nullopt;
+        return ret;
+    }
+
+    /// @brief Finds the hash in a level id without copying it
+    /// @param levelId The level id
+    /// @return A view into levelId of the hash if found, otherwise an empty view
+    METACORE_EXPORT std::string_view GetHashView(std::string_view levelId);
+    /// @brief Finds and parses the hash in a level id
+    /// @param levelId The level id
+    /// @return The binary hash of the level if found and valid, otherwise nullopt
+    METACORE_EXPORT std::optional<Hash> GetBinaryHash(std::string_view levelId);
+
     /// @brief Finds the hash in a level id
     /// @param levelId The level id
     /// @return The hash of the level if found, otherwise an empty string
@@ -24,12 +89,16 @@ namespace MetaCore::Songs {
     /// @brief Asynchronously retrieves the BeatmapData of a beatmap, will only run one task per beatmap at a time
     /// @param beatmap The beatmap key
     /// @param callback The callback with the data once it has been retrieved, or nullptr if it fails
-    METACORE_EXPORT void GetBeatmapData(GlobalNamespace::BeatmapKey beatmap, std::function<void(GlobalNamespace::IReadonlyBeatmapData*)> callback);
+    /// @return The task for the data, which will skip loading if all requests for the beatmap are cancelled
+    METACORE_EXPORT Task<GlobalNamespace::IReadonlyBeatmapData*>
+    GetBeatmapData(GlobalNamespace::BeatmapKey beatmap, std::function<void(GlobalNamespace::IReadonlyBeatmapData*)> callback = nullptr);
 
     /// @brief Asynchronously retrieves the cover sprite of a beatmap
     /// @param beatmap The beatmap level
     /// @param callback The callback with the sprite once it has been retrieved, or nullptr if it fails
-    METACORE_EXPORT void GetSongCover(GlobalNamespace::BeatmapLevel* beatmap, std::function<void(UnityEngine::Sprite*)> callback);
+    /// @return The task for the sprite
+    METACORE_EXPORT Task<UnityEngine::Sprite*>
+    GetSongCover(GlobalNamespace::BeatmapLevel* beatmap, std::function<void(UnityEngine::Sprite*)> callback = nullptr);
 
     /// @brief Finds the BeatmapLevel for a level id
     /// @param levelId The level id
@@ -39,6 +108,17 @@ namespace MetaCore::Songs {
     /// @param beatmap The beatmap key
     /// @return The beatmap level, or nullptr if not found
     METACORE_EXPORT GlobalNamespace::BeatmapLevel* FindLevel(GlobalNamespace::BeatmapKey beatmap);
+    /// @brief Finds the BeatmapLevel for a custom level hash
+    /// @param hash The binary hash of the level
+    /// @return The beatmap level, or nullptr if not found
+    METACORE_EXPORT GlobalNamespace::BeatmapLevel* FindLevel(Hash hash);
+    /// @brief Finds the BeatmapLevels for multiple level ids at once
+    /// @param levelIds The level ids
+    /// @return The beatmap levels in the same order as levelIds, with nullptr for any not found
+    METACORE_EXPORT std::vector<GlobalNamespace::BeatmapLevel*> FindLevels(std::span<std::string_view const> levelIds);
+    /// @brief Clears the index of loaded levels used by FindLevel, to be rebuilt on the next search
+    /// @note This is done automatically whenever the game reloads its level packs
+    METACORE_EXPORT void RefreshLevelIndex();
 
     /// @brief Gets the currently selected beatmap key
     /// @param last If the last selected beatmap should be returned even if the detail view has been closed
@@ -66,3 +146,13 @@ namespace MetaCore::Songs {
     /// @param beatmap The level to play the preview of
     METACORE_EXPORT void PlayLevelPreview(GlobalNamespace::BeatmapLevel* beatmap);
 }
+
+template <>
+struct std::hash<MetaCore::Songs::Hash> {
+    size_t operator()(MetaCore::Songs::Hash const& hash) const noexcept {
+        // the bytes are already uniformly distributed
+        size_t ret;
+        std::memcpy(&ret, hash.bytes.data(), sizeof(ret));
+        return ret;
+    }
+};
@@ -0,0 +1,202 @@
+#pragma once
+
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "export.h"
+
+namespace MetaCore {
+    namespace Engine {
+        // also declared in unity.hpp, which includes this header
+        METACORE_EXPORT void ScheduleMainThread(std::function<void()> callback);
+        /// @brief Logs an exception that was not handled inside a coroutine
+        /// @param exception The exception, from std::current_exception in unhandled_exception
+        METACORE_EXPORT void LogCoroutineException(std::exception_ptr exception);
+    }
+
+    /// @brief A handle to the result of an asynchronous operation, which can be cancelled to prevent its callbacks from running
+    /// @tparam T The result type of the operation
+    /// @note Completion and callbacks happen on the main thread, but cancellation and status checks are safe from any thread
+    template <class T>
+    struct Task {
+        /// @brief Constructor for a new incomplete task
+        Task() : state(std::make_shared<State>()) {}
+
+        /// @brief Cancels the task, so that no callbacks will be run for it. To supersede a task, cancel it before replacing it
+        void Cancel() const {
+            std::unique_lock lock(state->cancelMutex);
+            if (state->cancelled.exchange(true))
+                return;
+            auto callbacks = std::move(state->cancelCallbacks);
+            lock.unlock();
+            for (auto& callback : callbacks)
+                callback();
+        }
+
+        /// @brief Checks if the task has been cancelled
+        /// @return If the task has been cancelled
+        bool IsCancelled() const { return state->cancelled; }
+
+        /// @brief Checks if the task has finished with a result
+        /// @return If the task has finished with a result
+        bool IsCompleted() const { return state->completed; }
+
+        /// @brief Gets the result of the task, only valid if it has completed
+        /// @return A reference to the result of the task
+        T const& GetResult() const { return *state->result; }
+
+        /// @brief Adds a callback to be run with the result once the task completes, or immediately if it already has
+        /// @param callback The function to be run with the result
+        void Then(std::function<void(T const&)> callback) const {
+            if (!callback || IsCancelled())
+                return;
+            if (IsCompleted())
+                callback(GetResult());
+            else
+                state->callbacks.emplace_back(std::move(callback));
+        }
+
+        /// @brief Completes the task with a result and runs its callbacks, unless it has been cancelled or already completed
+        /// @param result The result of the operation
+        void Complete(T result) const {
+            if (IsCancelled() || IsCompleted())
+                return;
+            state->result.emplace(std::move(result));
+            state->completed = true;
+            auto callbacks = std::move(state->callbacks);
+            for (auto& callback : callbacks) {
+                // a callback can cancel the task as well
+                if (IsCancelled())
+                    break;
+                callback(GetResult());
+            }
+        }
+
+        bool operator==(Task const& other) const { return state == other.state; }
+
+        /// @brief Allows tasks to be awaited in coroutines, resuming on the main thread once completed
+        /// @note A coroutine awaiting a task that gets cancelled is destroyed on the main thread instead, cancelling its own task if it has one
+        auto operator co_await() const {
+            struct Awaiter {
+                Task task;
+                bool await_ready() const { return task.IsCompleted(); }
+                void await_suspend(std::coroutine_handle<> handle) const {
+                    // whichever of completion and cancellation comes first decides what happens to the coroutine
+                    auto finished = std::make_shared<std::atomic_bool>(false);
+                    task.Then([handle, finished](T const&) {
+                        if (!finished->exchange(true))
+                            handle.resume();
+                    });
+                    task.OnCancel([handle, finished]() {
+                        // cancellation can come from any thread, and the coroutine may still be running until it suspends
+                        Engine::ScheduleMainThread([handle, finished]() {
+                            if (!finished->exchange(true))
+                                handle.destroy();
+                        });
+                    });
+                }
+                T await_resume() const { return task.GetResult(); }
+            };
+            return Awaiter{*this};
+        }
+
+        /// @brief Allows coroutines to return a task, which is completed by co_return
+        struct promise_type {
+            // prevents aggregate initialization from coroutine parameters
+            promise_type() = default;
+            // destroyed without returning a value, so anything awaiting the task shouldn't wait forever
+            ~promise_type() {
+                if (!task.IsCompleted())
+                    task.Cancel();
+            }
+
+            Task task;
+            Task get_return_object() { return task; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_value(T value) { task.Complete(std::move(value)); }
+            void unhandled_exception() {
+                Engine::LogCoroutineException(std::current_exception());
+                task.Cancel();
+            }
+        };
+
+       private:
+        struct State {
+            std::atomic_bool cancelled = false;
+            std::atomic_bool completed = false;
+            std::optional<T> result = std::nullopt;
+            std::vector<std::function<void(T const&)>> callbacks = {};
+            std::mutex cancelMutex;
+            std::vector<std::function<void()>> cancelCallbacks = {};
+        };
+
+        // runs a function once the task is cancelled, on the cancelling thread, or immediately if it already has been
+        void OnCancel(std::function<void()> callback) const {
+            std::unique_lock lock(state->cancelMutex);
+            if (!state->cancelled) {
+                state->cancelCallbacks.emplace_back(std::move(callback));
+                return;
+            }
+            lock.unlock();
+            callback();
+        }
+
+        std::shared_ptr<State> state;
+    };
+
+    /// @brief A return type for fire and forget coroutines, which can co_await tasks and other awaitables such as Engine::NextFrame
+    struct Coroutine {
+        struct promise_type {
+            Coroutine get_return_object() noexcept { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() noexcept {}
+            void unhandled_exception() { Engine::LogCoroutineException(std::current_exception()); }
+        };
+    };
+
+    /// @brief A thread safe collection of tasks all waiting on the same operation
+    /// @tparam T The result type of the operation
+    template <class T>
+    struct TaskGroup {
+        /// @brief Adds a task to be completed with the operation
+        /// @param task The task to add
+        void Add(Task<T> task) {
+            std::unique_lock lock(mutex);
+            tasks.emplace_back(std::move(task));
+        }
+
+        /// @brief Checks if any of the tasks have not been cancelled, meaning the operation should continue
+        /// @return If any task is still waiting for a result
+        bool AnyActive() const {
+            std::unique_lock lock(mutex);
+            for (auto const& task : tasks) {
+                if (!task.IsCancelled())
+                    return true;
+            }
+            return false;
+        }
+
+        /// @brief Completes and removes all the tasks in the group
+        /// @param result The result of the operation
+        void Complete(T const& result) {
+            std::unique_lock lock(mutex);
+            auto completing = std::move(tasks);
+            tasks.clear();
+            lock.unlock();
+            for (auto& task : completing)
+                task.Complete(result);
+        }
+
+       private:
+        mutable std::mutex mutex;
+        std::vector<Task<T>> tasks;
+    };
+}
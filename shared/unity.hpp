@@ -1,5 +1,7 @@
 #pragma once
 
+#include <coroutine>
+
 #include "UnityEngine/GameObject.hpp"
 #include "UnityEngine/Quaternion.hpp"
 #include "UnityEngine/Sprite.hpp"
@@ -7,6 +9,7 @@
 #include "UnityEngine/Transform.hpp"
 #include "UnityEngine/Vector3.hpp"
 #include "export.h"
+#include "tasks.hpp"
 
 #if __has_include("BSML/shared/Helpers/utilities.hpp")
 #include "BSML/shared/Helpers/utilities.hpp"
@@ -48,12 +51,18 @@ namespace MetaCore::Engine {
     /// @param parent The top of the hierarchy to search
     /// @param name The name of the child to search for
     /// @return The child transform, or nullptr if not found
+    /// @note Uses a cached index of the hierarchy, which is rebuilt when it is found to be out of date, but at most once per frame on misses.
+    /// This adds a component to parent to detect changes to its direct children, but objects added deeper in the hierarchy with the same name
+    /// as an existing result are not detected, so use InvalidateHierarchy after making such changes
     METACORE_EXPORT UnityEngine::Transform* FindRecursive(TransformWrapper parent, std::string name);
     /// @brief Finds the path from a parent object to one of its children
     /// @param parent The starting point of the path in the hierarchy
     /// @param child The ending point of the path in the hierarchy
     /// @return The names of the objects between parent and (including) child separated by "/", or an empty string if child is not a child of parent
     METACORE_EXPORT std::string GetTransformPath(TransformWrapper parent, TransformWrapper child);
+    /// @brief Clears the cached index used by FindRecursive and GetTransformPath for a hierarchy, such as after adding objects deep in it
+    /// @param parent The top of the hierarchy that was searched
+    METACORE_EXPORT void InvalidateHierarchy(TransformWrapper parent);
     /// @brief Places a one child object a specific sibling amount away from another of its siblings
     /// @param child The object to move in the hierarchy
     /// @param ref The sibling to move child relative to
@@ -72,14 +81,14 @@ namespace MetaCore::Engine {
         return object->gameObject->template AddComponent<T>();
     }
 
-    /// @brief Scales a texture to a new size, using basic interpolation
+    /// @brief Scales a texture to a new size, averaging the covered area when downscaling at any ratio, and using bilinear interpolation when upscaling
     /// @param texture The original texture
     /// @param width The width for the output, or -1 to leave unchanged
     /// @param height The height for the output, or -1 to leave unchanged
     /// @param bounds The section of the texture to scale, or the full texture if width or height is 0
     /// @return The pixels of the scaled texture
     METACORE_EXPORT ArrayW<UnityEngine::Color> ScalePixels(UnityEngine::Texture2D* texture, int width, int height, UnityEngine::Rect bounds = {});
-    /// @brief Scales the texture of a sprite to a new size, using basic interpolation
+    /// @brief Scales the texture of a sprite to a new size, averaging the covered area when downscaling at any ratio, and using bilinear interpolation when upscaling
     /// @param texture The original texture
     /// @param width The width for the output, or -1 to leave unchanged
     /// @param height The height for the output, or -1 to leave unchanged
@@ -89,14 +98,14 @@ namespace MetaCore::Engine {
         return ScalePixels(sprite->texture, width, height, sprite->textureRect);
     }
 
-    /// @brief Scales a texture to a new size, using basic interpolation
+    /// @brief Scales a texture to a new size, averaging the covered area when downscaling at any ratio, and using bilinear interpolation when upscaling
     /// @param texture The original texture
     /// @param width The width for the output, or -1 to leave unchanged
     /// @param height The height for the output, or -1 to leave unchanged
     /// @param bounds The section of the texture to scale, or the full texture if width or height is 0
     /// @return The scaled texture
     METACORE_EXPORT UnityEngine::Texture2D* ScaleTexture(UnityEngine::Texture2D* texture, int width, int height, UnityEngine::Rect bounds = {});
-    /// @brief Scales the texture of a sprite to a new size, using basic interpolation
+    /// @brief Scales the texture of a sprite to a new size, averaging the covered area when downscaling at any ratio, and using bilinear interpolation when upscaling
     /// @param texture The original texture
     /// @param width The width for the output, or -1 to leave unchanged
     /// @param height The height for the output, or -1 to leave unchanged
@@ -106,8 +115,31 @@ namespace MetaCore::Engine {
         return ScaleTexture(sprite->texture, width, height, sprite->textureRect);
     }
 
+    /// @brief Scales a texture to a new size without blocking, on the gpu with an asynchronous readback if the texture isn't readable, or
+    /// otherwise on a worker thread after reading its pixels on the calling main thread
+    /// @param texture The original texture
+    /// @param width The width for the output, or -1 to leave unchanged
+    /// @param height The height for the output, or -1 to leave unchanged
+    /// @param bounds The section of the texture to scale, or the full texture if width or height is 0
+    /// @return The task for the scaled texture, which will be created on the main thread
+    METACORE_EXPORT Task<UnityEngine::Texture2D*> ScaleTextureAsync(UnityEngine::Texture2D* texture, int width, int height, UnityEngine::Rect bounds = {});
+    /// @brief Scales the texture of a sprite to a new size without blocking, on the gpu if the texture isn't readable
+    /// @param sprite The sprite with the original texture
+    /// @param width The width for the output, or -1 to leave unchanged
+    /// @param height The height for the output, or -1 to leave unchanged
+    /// @return The task for the scaled texture, which will be created on the main thread
+    inline Task<UnityEngine::Texture2D*> ScaleTextureAsync(UnityEngine::Sprite* sprite, int width, int height) {
+        return ScaleTextureAsync(sprite->texture, width, height, sprite->textureRect);
+    }
+
+    /// @brief Copies a texture into a new readable one with an asynchronous gpu readback, or synchronously if not supported
+    /// @param texture The original texture, which does not need to be readable
+    /// @param bounds The section of the texture to copy, or the full texture if width or height is 0
+    /// @return The task for the readable RGBA32 copy, which will be created on the main thread
+    METACORE_EXPORT Task<UnityEngine::Texture2D*> ReadTextureAsync(UnityEngine::Texture2D* texture, UnityEngine::Rect bounds = {});
+
 #if __has_include("BSML/shared/Helpers/utilities.hpp")
-    /// @brief Scales the texture of a sprite to a new size, using basic interpolation
+    /// @brief Scales the texture of a sprite to a new size, averaging the covered area when downscaling at any ratio, and using bilinear interpolation when upscaling
     /// @param sprite The sprite to modify
     /// @param width The width for the output, or -1 to leave unchanged
     /// @param height The height for the output, or -1 to leave unchanged
@@ -117,24 +149,92 @@ namespace MetaCore::Engine {
     }
 #endif
 
-    /// @brief Writes a texture to a file
+    /// @brief Writes a texture to a PNG file, encoding and writing it on a worker thread along with any other writes from the same frame
     /// @param texture The texture to write
-    /// @param file The path of the destination file
+    /// @param file The path of the destination file, which is created empty immediately so that UniqueFileName will skip it
     /// @param bounds The section of the texture to write, or the full texture if width or height is 0
-    METACORE_EXPORT void WriteTexture(UnityEngine::Texture2D* texture, std::string file, UnityEngine::Rect bounds = {});
-    /// @brief Writes the texture of a sprite to a file
+    /// @return The task for if the write succeeded, with the file replaced all at once when done
+    METACORE_EXPORT Task<bool> WriteTexture(UnityEngine::Texture2D* texture, std::string file, UnityEngine::Rect bounds = {});
+    /// @brief Writes the texture of a sprite to a PNG file, encoding and writing it on a worker thread
     /// @param sprite The sprite to write the texture of
-    /// @param file The path of the destination file
-    METACORE_EXPORT void WriteSprite(UnityEngine::Sprite* sprite, std::string file);
+    /// @param file The path of the destination file, which is created empty immediately so that UniqueFileName will skip it
+    /// @return The task for if the write succeeded, with the file replaced all at once when done
+    METACORE_EXPORT Task<bool> WriteSprite(UnityEngine::Sprite* sprite, std::string file);
+    /// @brief Sets the compression level used when writing textures to files
+    /// @param level The zlib compression level from 0 to 9, with higher levels being smaller but slower, and 6 by default
+    METACORE_EXPORT void SetPNGCompression(int level);
+
+    /// @brief Priorities for functions scheduled on the main thread, used when a frame budget is set
+    enum class Priority {
+        // Always run in the next frame, regardless of the budget
+        Gameplay,
+        // Run before background functions, the default
+        UI,
+        // Run only once all others have been run
+        Background,
+    };
 
     /// @brief Schedules a function to be run on the main thread
     /// @param callback The function to be run on the main thread
     METACORE_EXPORT void ScheduleMainThread(std::function<void()> callback);
+    /// @brief Schedules a function to be run on the main thread with a specific priority
+    /// @param callback The function to be run on the main thread
+    /// @param priority The priority of the function when a frame budget is set
+    METACORE_EXPORT void ScheduleMainThread(std::function<void()> callback, Priority priority);
     /// @brief Schedules a function to be run on the main thread once a condition returns true
     /// @param wait A function that returns true once the callback should be run
     /// @param callback The function to be run once the condition is true
     METACORE_EXPORT void ScheduleMainThread(std::function<bool()> wait, std::function<void()> callback);
 
+    /// @brief Sets the maximum time per frame to spend running scheduled functions, with the remainder carried over to later frames
+    /// @param milliseconds The time budget, or 0 to always run all scheduled functions (the default)
+    /// @note This applies to functions scheduled by all mods, and at least one of each priority is always run per frame
+    METACORE_EXPORT void SetMainThreadBudget(float milliseconds);
+    /// @brief Gets how long scheduled functions have been waiting to run due to the frame budget
+    /// @return The time in milliseconds since the oldest scheduled function was first deferred, or 0 if none are waiting
+    METACORE_EXPORT float GetMainThreadDeferral();
+
+    /// @brief An awaitable that resumes a coroutine on the main thread during the next frame (or later, if the frame budget has been reached)
+    struct NextFrame {
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle) const { ScheduleMainThread([handle]() { handle.resume(); }); }
+        void await_resume() const noexcept {}
+    };
+
+    /// @brief Runs a function on a shared pool of worker threads, then optionally another function on the main thread
+    /// @param task The function to be run on a worker thread, which must not use il2cpp objects
+    /// @param continuation The function to be run on the main thread once the task finishes, unless it throws
+    METACORE_EXPORT void RunInBackground(std::function<void()> task, std::function<void()> continuation = nullptr);
+    /// @brief Runs a function with a result on a shared pool of worker threads
+    /// @tparam F The type of the function
+    /// @tparam T The result type of the function
+    /// @param task The function to be run on a worker thread, which must not use il2cpp objects
+    /// @return The task for the result, which will be completed on the main thread, skipped entirely if cancelled before starting, and cancelled if the function throws
+    template <class F, class T = std::invoke_result_t<F>>
+    requires(!std::is_void_v<T>)
+    Task<T> RunInBackground(F task) {
+        Task<T> ret;
+        auto result = std::make_shared<std::optional<T>>();
+        RunInBackground(
+            [ret, result, task = std::move(task)]() mutable {
+                if (ret.IsCancelled())
+                    return;
+                try {
+                    result->emplace(task());
+                } catch (...) {
+                    // so that anything waiting on it doesn't wait forever, letting the worker log the exception
+                    ret.Cancel();
+                    throw;
+                }
+            },
+            [ret, result]() {
+                if (result->has_value())
+                    ret.Complete(std::move(**result));
+            }
+        );
+        return ret;
+    }
+
     /// @brief Sets a function to be run when a given object is enabled (via Unity's OnEnable callback)
     /// @param object The object to attach the callback to
     /// @param callback The callback to run when the object is enabled
@@ -150,9 +250,57 @@ namespace MetaCore::Engine {
     /// @param callback The callback to run when the object is destroyed
     METACORE_EXPORT void SetOnDestroy(TransformWrapper object, std::function<void()> callback);
 
-    /// @brief Schedules a function to be run every frame for the rest of the application
+    /// @brief Schedules a function to be run every frame until removed
     /// @param callback The function to be run every frame
-    METACORE_EXPORT void ScheduleOnUpdate(std::function<void()> callback);
+    /// @return The id for removal with RemoveOnUpdate
+    METACORE_EXPORT int ScheduleOnUpdate(std::function<void()> callback);
+    /// @brief Schedules a function to be run once every few frames until removed
+    /// @param callback The function to be run
+    /// @param frames The number of frames between each run, with 1 being every frame
+    /// @return The id for removal with RemoveOnUpdate
+    METACORE_EXPORT int ScheduleEveryFrames(std::function<void()> callback, int frames);
+    /// @brief Schedules a function to be run at a maximum rate until removed, checked once per frame
+    /// @param callback The function to be run
+    /// @param rate The number of times per second to run the function
+    /// @return The id for removal with RemoveOnUpdate
+    METACORE_EXPORT int ScheduleAtRate(std::function<void()> callback, float rate);
+    /// @brief Removes a function scheduled with ScheduleOnUpdate, ScheduleEveryFrames, or ScheduleAtRate, which will not be run again
+    /// @param id The id returned when the function was scheduled
+    METACORE_EXPORT void RemoveOnUpdate(int id);
+
+    /// @brief The time taken by a function scheduled to run on update
+    struct UpdateTiming {
+        int id;
+        int calls;
+        float averageMilliseconds;
+        float maxMilliseconds;
+    };
+
+    /// @brief Enables or disables timing of all functions scheduled to run on update, which has a small cost per function
+    /// @param enabled If the functions should be timed
+    METACORE_EXPORT void SetUpdateTiming(bool enabled);
+    /// @brief Gets the time taken by each function scheduled to run on update since timing was enabled, only from the main thread
+    /// @return The timings of the functions, most expensive on average first
+    METACORE_EXPORT std::vector<UpdateTiming> GetUpdateTimings();
+
+    /// @brief The time taken by MetaCore's own work in one of its hooks, not including the original game method
+    struct HookTiming {
+        std::string name;
+        int calls;
+        float medianMilliseconds;
+        float p99Milliseconds;
+        float maxMilliseconds;
+        float totalMilliseconds;
+    };
+
+    /// @brief Enables or disables timing of MetaCore's hooks, which are logged and reset at the end of each gameplay scene
+    /// @param enabled If the hooks should be timed
+    /// @param file A file to also append the timings to at the end of each gameplay scene, or empty for only logging
+    METACORE_EXPORT void SetHookProfiling(bool enabled, std::string file = "");
+    /// @brief Gets the time taken by each of MetaCore's hooks since profiling was enabled or the last gameplay scene ended
+    /// @return The timings of the hooks that have been called, most total time first
+    /// @note Percentiles are approximate, within about an eighth of the actual value
+    METACORE_EXPORT std::vector<HookTiming> GetHookTimings();
 
     /// @brief A struct to calculate the average of a number of rotations
     struct QuaternionAverage {
@@ -13,6 +13,7 @@
 #include "Zenject/SceneContextRegistry.hpp"
 #include "events.hpp"
 #include "main.hpp"
+#include "services.hpp"
 #include "types.hpp"
 #include "unity.hpp"
 
@@ -46,15 +47,10 @@ std::set<std::string> const& MetaCore::Game::GetScoreSubmissionDisablers() {
 }
 
 static FadeInOutController* GetFadeInOut() {
-    static UnityW<FadeInOutController> fadeInOutController;
-    if (!fadeInOutController) {
-        fadeInOutController = UnityEngine::Resources::FindObjectsOfTypeAll<FadeInOutController*>()->FirstOrDefault();
-        if (fadeInOutController)
-            MetaCore::Engine::SetOnDestroy(fadeInOutController, []() { fadeInOutController = nullptr; });
-    }
+    auto fadeInOutController = Services::Get<FadeInOutController>();
     if (!fadeInOutController)
         logger.warn("GetFadeInOut returning null");
-    return fadeInOutController.unsafePtr();
+    return fadeInOutController;
 }
 
 static void UpdateFadeInOut(float duration) {
@@ -107,6 +103,7 @@ PlayerDataModel* MetaCore::Game::GetPlayerData() {
 }
 
 UnityEngine::Material* MetaCore::Game::GetCurvedCornersMaterial() {
+    // materials aren't bound in any container, but this one is loaded with the game and only needs to be searched for once
     static UnityW<UnityEngine::Material> material;
     if (!material)
         material = UnityEngine::Resources::FindObjectsOfTypeAll<UnityEngine::Material*>()->First([](auto mat) {
@@ -116,39 +113,24 @@ UnityEngine::Material* MetaCore::Game::GetCurvedCornersMaterial() {
 }
 
 MenuTransitionsHelper* MetaCore::Game::GetMenuTransitionsHelper() {
-    static UnityW<MenuTransitionsHelper> menuTransitionsHelper;
-    if (!menuTransitionsHelper) {
-        menuTransitionsHelper = UnityEngine::Resources::FindObjectsOfTypeAll<MenuTransitionsHelper*>()->FirstOrDefault();
-        if (menuTransitionsHelper)
-            Engine::SetOnDestroy(menuTransitionsHelper, []() { menuTransitionsHelper = nullptr; });
-    }
+    auto menuTransitionsHelper = Services::Get<MenuTransitionsHelper>();
     if (!menuTransitionsHelper)
         logger.warn("GetMenuTransitionsHelper returning null");
-    return menuTransitionsHelper.unsafePtr();
+    return menuTransitionsHelper;
 }
 
 MainFlowCoordinator* MetaCore::Game::GetMainFlowCoordinator() {
-    static UnityW<MainFlowCoordinator> mainFlowCoordinator;
-    if (!mainFlowCoordinator) {
-        mainFlowCoordinator = UnityEngine::Resources::FindObjectsOfTypeAll<MainFlowCoordinator*>()->FirstOrDefault();
-        if (mainFlowCoordinator)
-            Engine::SetOnDestroy(mainFlowCoordinator, []() { mainFlowCoordinator = nullptr; });
-    }
+    auto mainFlowCoordinator = Services::Get<MainFlowCoordinator>();
     if (!mainFlowCoordinator)
         logger.warn("GetMainFlowCoordinator returning null");
-    return mainFlowCoordinator.unsafePtr();
+    return mainFlowCoordinator;
 }
 
 MainSystemInit* MetaCore::Game::GetMainSystemInit() {
-    static UnityW<MainSystemInit> mainSystemInit;
-    if (!mainSystemInit) {
-        mainSystemInit = UnityEngine::Resources::FindObjectsOfTypeAll<MainSystemInit*>()->FirstOrDefault();
-        if (mainSystemInit)
-            Engine::SetOnDestroy(mainSystemInit, []() { mainSystemInit = nullptr; });
-    }
+    auto mainSystemInit = Services::Get<MainSystemInit>();
     if (!mainSystemInit)
         logger.warn("GetMainSystemInit returning null");
-    return mainSystemInit.unsafePtr();
+    return mainSystemInit;
 }
 
 Zenject::DiContainer* MetaCore::Game::GetAppDiContainer() {
@@ -3,6 +3,7 @@
 #include "GlobalNamespace/AnnotatedBeatmapLevelCollectionsViewController.hpp"
 #include "GlobalNamespace/AudioTimeSyncController.hpp"
 #include "GlobalNamespace/BeatmapObjectExecutionRatingsRecorder.hpp"
+#include "GlobalNamespace/BeatmapLevelsModel.hpp"
 #include "GlobalNamespace/BeatmapObjectManager.hpp"
 #include "GlobalNamespace/CutScoreBuffer.hpp"
 #include "GlobalNamespace/FadeInOutController.hpp"
@@ -37,6 +38,7 @@
 #include "UnityEngine/Time.hpp"
 #include "UnityEngine/WaitForSeconds.hpp"
 #include "VRUIControls/VRGraphicRaycaster.hpp"
+#include "Zenject/SceneContext.hpp"
 #include "beatsaber-hook/shared/utils/hooking.hpp"
 #include "custom-types/shared/coroutine.hpp"
 #include "events.hpp"
@@ -44,6 +46,8 @@
 #include "input.hpp"
 #include "internals.hpp"
 #include "main.hpp"
+#include "profiler.hpp"
+#include "services.hpp"
 #include "songs.hpp"
 #include "stats.hpp"
 #include "types.hpp"
@@ -54,17 +58,15 @@ using namespace MetaCore;
 
 static bool inGameplayScene = false;
 
-static std::set<int> pressedButtons;
-
 static bool IsGameplayScene(UnityW<ScenesTransitionSetupDataSO> scene) {
     return scene && scene.try_cast<LevelScenesTransitionSetupDataSO>();
 }
 
-static void CheckInitialize(UnityW<ScenesTransitionSetupDataSO> scene) {
+static void CheckInitialize(UnityW<ScenesTransitionSetupDataSO> scene, Zenject::DiContainer* container) {
     if (!IsGameplayScene(scene))
         return;
     logger.debug("gameplay scene start");
-    Internals::Initialize();
+    Internals::Initialize(container);
     Events::Broadcast(Events::GameplaySceneStarted);
     inGameplayScene = true;
 }
@@ -85,6 +87,8 @@ static void CheckSceneFinish() {
     logger.debug("gameplay scene finish");
     Events::Broadcast(Events::GameplaySceneEnded);
     inGameplayScene = false;
+    // after the hook that ended the scene has been timed
+    Engine::ScheduleMainThread(Profiler::Dump);
 }
 
 // update score and max score
@@ -93,6 +97,7 @@ MAKE_AUTO_HOOK_MATCH(
 ) {
     ScoreController_DespawnScoringElement(self, scoringElement);
 
+    PROFILE_HOOK();
     int cutScore = scoringElement->cutScore * scoringElement->multiplier;
     int maxCutScore = scoringElement->maxPossibleCutScore * scoringElement->maxMultiplier;
 
@@ -138,6 +143,7 @@ MAKE_AUTO_HOOK_MATCH(
 ) {
     BeatmapObjectManager_HandleNoteControllerNoteWasCut(self, noteController, info);
 
+    PROFILE_HOOK();
     bool left = info->saberType == SaberType::SaberA;
     bool bomb = noteController->noteData->gameplayType == NoteData::GameplayType::Bomb;
     if (!bomb && Stats::IsFakeNote(noteController->noteData))
@@ -193,6 +199,7 @@ MAKE_AUTO_HOOK_MATCH(
 ) {
     BeatmapObjectManager_HandleNoteControllerNoteWasMissed(self, noteController);
 
+    PROFILE_HOOK();
     if (noteController->noteData->gameplayType == NoteData::GameplayType::Bomb || Stats::IsFakeNote(noteController->noteData))
         return;
 
@@ -251,11 +258,13 @@ MAKE_AUTO_HOOK_MATCH(
     ISaberSwingRatingCounter* swingRatingCounter
 ) {
     CutScoreBuffer_HandleSaberSwingRatingCounterDidFinish(self, swingRatingCounter);
+    PROFILE_HOOK();
     HandleCutFinish(self);
 }
 
 MAKE_AUTO_HOOK_MATCH(CutScoreBuffer_Init, &CutScoreBuffer::Init, bool, CutScoreBuffer* self, ByRef<NoteCutInfo> noteCutInfo) {
     bool notYetFinished = CutScoreBuffer_Init(self, noteCutInfo);
+    PROFILE_HOOK();
     if (!notYetFinished)
         HandleCutFinish(self);
     return notYetFinished;
@@ -271,6 +280,7 @@ MAKE_AUTO_HOOK_MATCH(
 ) {
     BeatmapObjectExecutionRatingsRecorder_HandlePlayerHeadDidEnterObstacle(self, obstacleController);
 
+    PROFILE_HOOK();
     Internals::wallsHit++;
     Internals::combo = 0;
     Events::Broadcast(Events::WallHit);
@@ -285,6 +295,7 @@ MAKE_AUTO_HOOK_MATCH(
 
     GameEnergyCounter_ProcessEnergyChange(self, energyChange);
 
+    PROFILE_HOOK();
     if (Internals::noFail && wasAbove0 && self->_didReach0Energy) {
         Internals::negativeMods -= 0.5;
         Events::Broadcast(Events::ScoreChanged);
@@ -301,7 +312,10 @@ MAKE_AUTO_HOOK_MATCH(
     GameScenesManager::__c__DisplayClass40_0* self,
     Zenject::DiContainer* container
 ) {
-    CheckInitialize(self->scenesTransitionSetupData);
+    {
+        PROFILE_HOOK();
+        CheckInitialize(self->scenesTransitionSetupData, container);
+    }
 
     GameScenesManager_PushScenes_Delegate(self, container);
 }
@@ -314,7 +328,10 @@ MAKE_AUTO_HOOK_MATCH(
     GameScenesManager::__c__DisplayClass42_0* self,
     Zenject::DiContainer* container
 ) {
-    CheckInitialize(self->scenesTransitionSetupData);
+    {
+        PROFILE_HOOK();
+        CheckInitialize(self->scenesTransitionSetupData, container);
+    }
 
     GameScenesManager_ReplaceScenes_Delegate_AfterLoad(self, container);
 }
@@ -323,8 +340,11 @@ MAKE_AUTO_HOOK_MATCH(
 MAKE_AUTO_HOOK_MATCH(
     AudioTimeSyncController_StartSong, &AudioTimeSyncController::StartSong, void, AudioTimeSyncController* self, float startTimeOffset
 ) {
-    logger.info("level start");
-    Events::Broadcast(Events::MapStarted);
+    {
+        PROFILE_HOOK();
+        logger.info("level start");
+        Events::Broadcast(Events::MapStarted);
+    }
 
     AudioTimeSyncController_StartSong(self, startTimeOffset);
 }
@@ -334,6 +354,7 @@ MAKE_AUTO_HOOK_MATCH(AudioTimeSyncController_Update, &AudioTimeSyncController::U
 
     AudioTimeSyncController_Update(self);
 
+    PROFILE_HOOK();
     if (!Internals::stateValid)
         return;
 
@@ -346,6 +367,7 @@ MAKE_AUTO_HOOK_MATCH(AudioTimeSyncController_Update, &AudioTimeSyncController::U
 MAKE_AUTO_HOOK_MATCH(PauseMenuManager_ShowMenu, &PauseMenuManager::ShowMenu, void, PauseMenuManager* self) {
 
     PauseMenuManager_ShowMenu(self);
+    PROFILE_HOOK();
     Events::Broadcast(Events::MapPaused);
 }
 
@@ -354,6 +376,7 @@ MAKE_AUTO_HOOK_MATCH(
     PauseMenuManager_HandleResumeFromPauseAnimationDidFinish, &PauseMenuManager::HandleResumeFromPauseAnimationDidFinish, void, PauseMenuManager* self
 ) {
     PauseMenuManager_HandleResumeFromPauseAnimationDidFinish(self);
+    PROFILE_HOOK();
     Events::Broadcast(Events::MapUnpaused);
 }
 
@@ -365,6 +388,7 @@ MAKE_AUTO_HOOK_MATCH(
     MultiplayerLocalActivePlayerInGameMenuController* self
 ) {
     MultiplayerLocalActivePlayerInGameMenuController_ShowInGameMenu(self);
+    PROFILE_HOOK();
     Events::Broadcast(Events::MapPaused);
 }
 
@@ -376,6 +400,7 @@ MAKE_AUTO_HOOK_MATCH(
     MultiplayerLocalActivePlayerInGameMenuController* self
 ) {
     MultiplayerLocalActivePlayerInGameMenuController_HideInGameMenu(self);
+    PROFILE_HOOK();
     Events::Broadcast(Events::MapUnpaused);
 }
 
@@ -388,8 +413,11 @@ MAKE_AUTO_HOOK_MATCH(
     StandardLevelScenesTransitionSetupDataSO* standardLevelScenesTransitionSetupData,
     LevelCompletionResults* levelCompletionResults
 ) {
-    logger.info("standard level end {}", (int) levelCompletionResults->levelEndAction);
-    CheckEarlyFinish(levelCompletionResults->levelEndAction);
+    {
+        PROFILE_HOOK();
+        logger.info("standard level end {}", (int) levelCompletionResults->levelEndAction);
+        CheckEarlyFinish(levelCompletionResults->levelEndAction);
+    }
 
     MenuTransitionsHelper_HandleMainGameSceneDidFinish(self, standardLevelScenesTransitionSetupData, levelCompletionResults);
 }
@@ -403,8 +431,11 @@ MAKE_AUTO_HOOK_MATCH(
     MissionLevelScenesTransitionSetupDataSO* missionLevelScenesTransitionSetupData,
     MissionCompletionResults* missionCompletionResults
 ) {
-    logger.info("campaign level end {}", (int) missionCompletionResults->levelCompletionResults->levelEndAction);
-    CheckEarlyFinish(missionCompletionResults->levelCompletionResults->levelEndAction);
+    {
+        PROFILE_HOOK();
+        logger.info("campaign level end {}", (int) missionCompletionResults->levelCompletionResults->levelEndAction);
+        CheckEarlyFinish(missionCompletionResults->levelCompletionResults->levelEndAction);
+    }
 
     MenuTransitionsHelper_HandleMissionLevelSceneDidFinish(self, missionLevelScenesTransitionSetupData, missionCompletionResults);
 }
@@ -418,8 +449,11 @@ MAKE_AUTO_HOOK_MATCH(
     MultiplayerLevelScenesTransitionSetupDataSO* multiplayerLevelScenesTransitionSetupData,
     MultiplayerResultsData* multiplayerResultsData
 ) {
-    logger.info("multiplayer level end");
-    CheckEarlyFinish(LevelCompletionResults::LevelEndAction::None);
+    {
+        PROFILE_HOOK();
+        logger.info("multiplayer level end");
+        CheckEarlyFinish(LevelCompletionResults::LevelEndAction::None);
+    }
 
     MenuTransitionsHelper_HandleMultiplayerLevelDidFinish(self, multiplayerLevelScenesTransitionSetupData, multiplayerResultsData);
 }
@@ -433,8 +467,11 @@ MAKE_AUTO_HOOK_MATCH(
     MultiplayerLevelScenesTransitionSetupDataSO* multiplayerLevelScenesTransitionSetupData,
     DisconnectedReason disconnectedReason
 ) {
-    logger.info("multiplayer level disconnect");
-    CheckEarlyFinish(LevelCompletionResults::LevelEndAction::Quit);
+    {
+        PROFILE_HOOK();
+        logger.info("multiplayer level disconnect");
+        CheckEarlyFinish(LevelCompletionResults::LevelEndAction::Quit);
+    }
 
     MenuTransitionsHelper_HandleMultiplayerLevelDidDisconnect(self, multiplayerLevelScenesTransitionSetupData, disconnectedReason);
 }
@@ -447,7 +484,10 @@ MAKE_AUTO_HOOK_MATCH(
     GameScenesManager::__c__DisplayClass41_0* self,
     Zenject::DiContainer* container
 ) {
-    CheckSceneFinish();
+    {
+        PROFILE_HOOK();
+        CheckSceneFinish();
+    }
 
     GameScenesManager_PopScenes_Delegate(self, container);
 }
@@ -460,7 +500,10 @@ MAKE_AUTO_HOOK_MATCH(
     GameScenesManager::__c__DisplayClass42_0* self,
     Zenject::DiContainer* container
 ) {
-    CheckSceneFinish();
+    {
+        PROFILE_HOOK();
+        CheckSceneFinish();
+    }
 
     GameScenesManager_ReplaceScenes_Delegate_AfterUnload(self, container);
 }
@@ -473,8 +516,12 @@ MAKE_AUTO_HOOK_MATCH(
     MenuTransitionsHelper* self,
     System::Action_1<Zenject::DiContainer*>* finishCallback
 ) {
-    logger.info("soft restart");
-    Events::Broadcast(Events::SoftRestart);
+    {
+        PROFILE_HOOK();
+        logger.info("soft restart");
+        Songs::RefreshLevelIndex();
+        Events::Broadcast(Events::SoftRestart);
+    }
 
     MenuTransitionsHelper_RestartGame(self, finishCallback);
 }
@@ -530,7 +577,10 @@ static void AddSignalUpdates(UnityEngine::Component* self, std::function<void()>
 MAKE_AUTO_HOOK_MATCH(
     StandardLevelDetailView_SetContentForBeatmapData, &StandardLevelDetailView::SetContentForBeatmapData, void, StandardLevelDetailView* self
 ) {
-    AddSignalUpdates(self, Internals::ClearLevel, [self]() { Internals::SetLevel(self->beatmapKey, self->_beatmapLevel); });
+    {
+        PROFILE_HOOK();
+        AddSignalUpdates(self, Internals::ClearLevel, [self]() { Internals::SetLevel(self->beatmapKey, self->_beatmapLevel); });
+    }
 
     StandardLevelDetailView_SetContentForBeatmapData(self);
 }
@@ -539,9 +589,12 @@ MAKE_AUTO_HOOK_MATCH(
 MAKE_AUTO_HOOK_MATCH(
     MissionLevelDetailViewController_RefreshContent, &MissionLevelDetailViewController::RefreshContent, void, MissionLevelDetailViewController* self
 ) {
-    AddSignalUpdates(self, Internals::ClearLevel, [key = self->missionNode->missionData->beatmapKey]() {
-        Internals::SetLevel(key, Songs::FindLevel(key));
-    });
+    {
+        PROFILE_HOOK();
+        AddSignalUpdates(self, Internals::ClearLevel, [key = self->missionNode->missionData->beatmapKey]() {
+            Internals::SetLevel(key, Songs::FindLevel(key));
+        });
+    }
 
     MissionLevelDetailViewController_RefreshContent(self);
 }
@@ -556,6 +609,7 @@ MAKE_AUTO_HOOK_MATCH(
 ) {
     AnnotatedBeatmapLevelCollectionsViewController_HandleDidSelectAnnotatedBeatmapLevelCollection(self, pack);
 
+    PROFILE_HOOK();
     AddSignalUpdates(self, Internals::ClearPlaylist, [pack]() { Internals::SetPlaylist(pack); });
 }
 
@@ -571,27 +625,37 @@ MAKE_AUTO_HOOK_MATCH(
 ) {
     AnnotatedBeatmapLevelCollectionsViewController_SetData(self, packs, selectedItemIndex, hideIfOneOrNoPacks);
 
+    PROFILE_HOOK();
     AddSignalUpdates(self, Internals::ClearPlaylist, [pack = packs->get_Item(selectedItemIndex)]() { Internals::SetPlaylist(pack); });
 }
 
+// keep the level index up to date with loaded levels
+MAKE_AUTO_HOOK_MATCH(
+    BeatmapLevelsModel_UpdateAllLoadedBeatmapLevelPacks,
+    &BeatmapLevelsModel::UpdateAllLoadedBeatmapLevelPacks,
+    void,
+    BeatmapLevelsModel* self
+) {
+    BeatmapLevelsModel_UpdateAllLoadedBeatmapLevelPacks(self);
+
+    PROFILE_HOOK();
+    Songs::RefreshLevelIndex();
+}
+
+// track scene containers to find singletons in
+MAKE_AUTO_HOOK_MATCH(SceneContext_Install, &Zenject::SceneContext::Install, void, Zenject::SceneContext* self) {
+    SceneContext_Install(self);
+
+    PROFILE_HOOK();
+    Services::AddContext(self);
+}
+
 // run input button events
 MAKE_AUTO_HOOK_MATCH(OVRInput_Update, &OVRInput::Update, void) {
     OVRInput_Update();
 
-    for (int i = 0; i <= Input::ButtonsMax; i++) {
-        bool pressed = Input::GetPressed(Input::Either, (Input::Buttons) i);
-        bool wasPressed = pressedButtons.contains(i);
-        if (pressed && !wasPressed) {
-            Events::Broadcast(Input::PressEvents, i);
-            pressedButtons.emplace(i);
-        }
-        if (pressed)
-            Events::Broadcast(Input::HoldEvents, i);
-        if (!pressed && wasPressed) {
-            Events::Broadcast(Input::ReleaseEvents, i);
-            pressedButtons.erase(i);
-        }
-    }
+    PROFILE_HOOK();
+    Internals::UpdateInput();
 }
 
 // run keyboard closed callbacks
@@ -600,6 +664,7 @@ MAKE_AUTO_HOOK_MATCH(
 ) {
     InputFieldView_DeactivateKeyboard(self, keyboard);
 
+    PROFILE_HOOK();
     auto handler = self->GetComponent<KeyboardCloseHandler*>();
     if (handler && handler->closeCallback)
         handler->closeCallback();
@@ -608,9 +673,12 @@ MAKE_AUTO_HOOK_MATCH(
 // run keyboard ok button callbacks
 MAKE_AUTO_HOOK_MATCH(UIKeyboardManager_HandleKeyboardOkButton, &UIKeyboardManager::HandleKeyboardOkButton, void, UIKeyboardManager* self) {
 
-    auto handler = self->_selectedInput->GetComponent<KeyboardCloseHandler*>();
-    if (handler && handler->okCallback)
-        handler->okCallback();
+    {
+        PROFILE_HOOK();
+        auto handler = self->_selectedInput->GetComponent<KeyboardCloseHandler*>();
+        if (handler && handler->okCallback)
+            handler->okCallback();
+    }
 
     UIKeyboardManager_HandleKeyboardOkButton(self);
 }
@@ -625,6 +693,7 @@ MAKE_AUTO_HOOK_MATCH(
 ) {
     auto cell = IconSegmentedControl_CellForCellNumber(self, cellNumber);
 
+    PROFILE_HOOK();
     if (!cell->interactable) {
         cell->enabled = false;
         if (auto cast = cell.try_cast<HMUI::IconSegmentedControlCell>().value_or(nullptr))
@@ -650,6 +719,8 @@ MAKE_AUTO_ORIG_HOOK_MATCH(
     float duration,
     System::Action* finishedCallback
 ) {
+    PROFILE_HOOK();
+    Services::Capture(self);
     Game::SetCameraFadeOut(BASE_GAME_ID, false, duration);
     if (!finishedCallback)
         return;
@@ -668,6 +739,8 @@ MAKE_AUTO_ORIG_HOOK_MATCH(
     float duration,
     System::Action* finishedCallback
 ) {
+    PROFILE_HOOK();
+    Services::Capture(self);
     Game::SetCameraFadeOut(BASE_GAME_ID, true, duration);
     if (!finishedCallback)
         return;
@@ -722,10 +795,13 @@ AUTO_INSTALL_FUNCTION(Abort) {
 // hook abort and provide backtraces
 MAKE_HOOK(delete_object_internal_step1, nullptr, void, char* object) {
     int instanceId = *(int*) (object + 8);
-    auto destroy = ObjectSignal::onDestroys.find(instanceId);
-    if (destroy != ObjectSignal::onDestroys.end() && destroy->second) {
-        destroy->second();
-        ObjectSignal::onDestroys.erase(destroy);
+    {
+        PROFILE_HOOK();
+        auto destroy = ObjectSignal::onDestroys.find(instanceId);
+        if (destroy != ObjectSignal::onDestroys.end() && destroy->second) {
+            destroy->second();
+            ObjectSignal::onDestroys.erase(destroy);
+        }
     }
     delete_object_internal_step1(object);
 }
@@ -0,0 +1,253 @@
+#include "image.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include <zlib.h>
+
+using namespace MetaCore;
+
+// weights for each output pixel sum to 1 << WeightBits
+static constexpr int WeightBits = 14;
+// the intermediate row keeps 8 extra bits of precision while still fitting in 16 bits
+static constexpr int RowShift = WeightBits - 8;
+static constexpr int OutputShift = WeightBits + 8;
+
+namespace {
+    // the contiguous source pixels contributing to each output pixel along one axis
+    struct Filter {
+        std::vector<int> starts;
+        std::vector<int> counts;
+        std::vector<int> offsets;
+        std::vector<uint16_t> weights;
+    };
+}
+
+static void AddTaps(Filter& filter, int start, std::vector<float> const& coverage) {
+    int count = coverage.size();
+    float total = 0;
+    for (float value : coverage)
+        total += value;
+
+    filter.starts.emplace_back(start);
+    filter.counts.emplace_back(count);
+    filter.offsets.emplace_back(filter.weights.size());
+
+    // rounding the running total makes sure the weights sum exactly, so that solid colors stay the same
+    float covered = 0;
+    int previous = 0;
+    for (float value : coverage) {
+        covered += value;
+        int next = std::lround(covered / total * (1 << WeightBits));
+        filter.weights.emplace_back(next - previous);
+        previous = next;
+    }
+}
+
+// averages the covered area when downscaling, which is a box prefilter at any ratio, and interpolates linearly when upscaling
+static Filter GetFilter(int sourceSize, int size) {
+    Filter ret;
+    float scale = sourceSize / (float) size;
+    std::vector<float> coverage;
+
+    for (int i = 0; i < size; i++) {
+        coverage.clear();
+        if (scale > 1) {
+            float begin = i * scale;
+            float end = begin + scale;
+            int first = begin;
+            int last = std::min((int) std::ceil(end), sourceSize);
+            for (int j = first; j < last; j++)
+                coverage.emplace_back(std::max(std::min<float>(end, j + 1) - std::max<float>(begin, j), 0.f));
+            AddTaps(ret, first, coverage);
+        } else {
+            float center = std::clamp((i + 0.5f) * scale - 0.5f, 0.f, sourceSize - 1.f);
+            int first = std::min((int) center, std::max(sourceSize - 2, 0));
+            float fraction = center - first;
+            coverage.emplace_back(1 - fraction);
+            if (first + 1 < sourceSize)
+                coverage.emplace_back(fraction);
+            AddTaps(ret, first, coverage);
+        }
+    }
+    return ret;
+}
+
+static void FilterRows(Image::View source, Filter const& filter, int index, uint32_t* sums, uint16_t* out, int count) {
+    std::fill(sums, sums + count, 0);
+    int start = filter.starts[index];
+    for (int tap = 0; tap < filter.counts[index]; tap++) {
+        uint8_t const* row = source.Row(start + tap);
+        uint16_t weight = filter.weights[filter.offsets[index] + tap];
+        int i = 0;
+#if defined(__ARM_NEON)
+        for (; i + 8 <= count; i += 8) {
+            uint16x8_t values = vmovl_u8(vld1_u8(row + i));
+            vst1q_u32(sums + i, vmlal_n_u16(vld1q_u32(sums + i), vget_low_u16(values), weight));
+            vst1q_u32(sums + i + 4, vmlal_n_u16(vld1q_u32(sums + i + 4), vget_high_u16(values), weight));
+        }
+#endif
+        for (; i < count; i++)
+            sums[i] += (uint32_t) row[i] * weight;
+    }
+    int i = 0;
+#if defined(__ARM_NEON)
+    for (; i + 4 <= count; i += 4)
+        vst1_u16(out + i, vrshrn_n_u32(vld1q_u32(sums + i), RowShift));
+#endif
+    for (; i < count; i++)
+        out[i] = (sums[i] + (1 << (RowShift - 1))) >> RowShift;
+}
+
+static void FilterColumns(uint16_t const* row, Filter const& filter, uint8_t* out) {
+    int size = filter.starts.size();
+    for (int x = 0; x < size; x++) {
+        uint16_t const* pixel = row + filter.starts[x] * 4;
+        uint16_t const* weights = filter.weights.data() + filter.offsets[x];
+        int count = filter.counts[x];
+#if defined(__ARM_NEON)
+        uint32x4_t sum = vdupq_n_u32(0);
+        for (int tap = 0; tap < count; tap++)
+            sum = vmlal_n_u16(sum, vld1_u16(pixel + tap * 4), weights[tap]);
+        uint16x4_t narrowed = vmovn_u32(vrshrq_n_u32(sum, OutputShift));
+        uint8x8_t bytes = vmovn_u16(vcombine_u16(narrowed, narrowed));
+        vst1_lane_u32((uint32_t*) out, vreinterpret_u32_u8(bytes), 0);
+#else
+        uint32_t sum[4] = {};
+        for (int tap = 0; tap < count; tap++) {
+            for (int channel = 0; channel < 4; channel++)
+                sum[channel] += (uint32_t) pixel[tap * 4 + channel] * weights[tap];
+        }
+        for (int channel = 0; channel < 4; channel++)
+            out[channel] = (sum[channel] + (1 << (OutputShift - 1))) >> OutputShift;
+#endif
+        out += 4;
+    }
+}
+
+Image::Buffer Image::Scale(View source, int width, int height) {
+    Buffer ret(width, height);
+    if (source.width <= 0 || source.height <= 0 || width <= 0 || height <= 0)
+        return ret;
+
+    if (width == source.width && height == source.height) {
+        for (int y = 0; y < height; y++)
+            std::memcpy(ret.Row(y), source.Row(y), width * 4);
+        return ret;
+    }
+
+    auto columns = GetFilter(source.width, width);
+    auto rows = GetFilter(source.height, height);
+
+    int count = source.width * 4;
+    std::vector<uint32_t> sums(count);
+    std::vector<uint16_t> row(count);
+
+    for (int y = 0; y < height; y++) {
+        FilterRows(source, rows, y, sums.data(), row.data(), count);
+        FilterColumns(row.data(), columns, ret.Row(y));
+    }
+    return ret;
+}
+
+static uint8_t Paeth(uint8_t left, uint8_t up, uint8_t upLeft) {
+    int estimate = left + up - upLeft;
+    int distanceLeft = std::abs(estimate - left);
+    int distanceUp = std::abs(estimate - up);
+    int distanceUpLeft = std::abs(estimate - upLeft);
+    if (distanceLeft <= distanceUp && distanceLeft <= distanceUpLeft)
+        return left;
+    if (distanceUp <= distanceUpLeft)
+        return up;
+    return upLeft;
+}
+
+// applies one of the png filter types (none, sub, up, average, paeth) to a row, returning a cost estimate for the result
+static uint32_t FilterRow(int type, uint8_t const* row, uint8_t const* previous, int count, uint8_t* out) {
+    uint32_t cost = 0;
+    for (int i = 0; i < count; i++) {
+        uint8_t left = i >= 4 ? row[i - 4] : 0;
+        uint8_t up = previous[i];
+        uint8_t upLeft = i >= 4 ? previous[i - 4] : 0;
+        uint8_t predicted = 0;
+        switch (type) {
+            case 1:
+                predicted = left;
+                break;
+            case 2:
+                predicted = up;
+                break;
+            case 3:
+                predicted = (left + up) / 2;
+                break;
+            case 4:
+                predicted = Paeth(left, up, upLeft);
+                break;
+        }
+        out[i] = row[i] - predicted;
+        cost += std::abs((int8_t) out[i]);
+    }
+    return cost;
+}
+
+static void AppendInt(std::string& out, uint32_t value) {
+    for (int shift = 24; shift >= 0; shift -= 8)
+        out.push_back((char) (value >> shift));
+}
+
+static void AppendChunk(std::string& out, char const* type, uint8_t const* data, size_t size) {
+    AppendInt(out, size);
+    size_t start = out.size();
+    out.append(type, 4);
+    out.append((char const*) data, size);
+    AppendInt(out, crc32(0, (uint8_t const*) out.data() + start, size + 4));
+}
+
+std::string Image::EncodePNG(View source, int level) {
+    int count = source.width * 4;
+    std::vector<uint8_t> filtered((count + 1) * source.height);
+    std::vector<uint8_t> zeros(count);
+    std::vector<uint8_t> candidate(count);
+
+    for (int y = 0; y < source.height; y++) {
+        uint8_t const* row = source.Row(y);
+        uint8_t const* previous = y > 0 ? source.Row(y - 1) : zeros.data();
+        uint8_t* out = filtered.data() + y * (count + 1);
+        // the usual heuristic of picking the filter with the smallest sum of signed differences
+        uint32_t best = FilterRow(0, row, previous, count, out + 1);
+        out[0] = 0;
+        for (int type = 1; type <= 4; type++) {
+            uint32_t cost = FilterRow(type, row, previous, count, candidate.data());
+            if (cost < best) {
+                best = cost;
+                out[0] = type;
+                std::memcpy(out + 1, candidate.data(), count);
+            }
+        }
+    }
+
+    uLongf compressedSize = compressBound(filtered.size());
+    std::vector<uint8_t> compressed(compressedSize);
+    if (compress2(compressed.data(), &compressedSize, filtered.data(), filtered.size(), std::clamp(level, 0, 9)) != Z_OK)
+        return "";
+
+    // 8 bit depth, RGBA color, default compression, filtering, and interlacing
+    uint8_t header[13] = {0, 0, 0, 0, 0, 0, 0, 0, 8, 6, 0, 0, 0};
+    for (int i = 0; i < 4; i++) {
+        header[i] = source.width >> (24 - i * 8);
+        header[i + 4] = source.height >> (24 - i * 8);
+    }
+
+    std::string ret = "\x89PNG\r\n\x1a\n";
+    ret.reserve(compressedSize + 64);
+    AppendChunk(ret, "IHDR", header, sizeof(header));
+    AppendChunk(ret, "IDAT", compressed.data(), compressedSize);
+    AppendChunk(ret, "IEND", nullptr, 0);
+    return ret;
+}
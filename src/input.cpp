@@ -1,10 +1,20 @@
 #include "input.hpp"
 
+#include <array>
+#include <bit>
+#include <cmath>
+#include <limits>
+
 #include "GlobalNamespace/OVRInput.hpp"
 #include "UnityEngine/EventSystems/EventSystem.hpp"
 #include "UnityEngine/Resources.hpp"
 #include "UnityEngine/SpatialTracking/PoseDataSource.hpp"
+#include "UnityEngine/Time.hpp"
 #include "UnityEngine/XR/XRNode.hpp"
+#include "events.hpp"
+#include "internals.hpp"
+#include "operators.hpp"
+#include "services.hpp"
 #include "unity.hpp"
 
 using namespace GlobalNamespace;
@@ -29,11 +39,158 @@ static std::vector<OVRInput::Controller> const ControllersMap = {
     OVRInput::Controller::LTouch, OVRInput::Controller::RTouch, OVRInput::Controller::Active, OVRInput::Controller::Touch
 };
 
+static constexpr int ButtonCount = MetaCore::Input::ButtonsMax + 1;
+
+// the raw buttons for ButtonsMap on the left and right controllers, which can all be read with Controller::Touch
+static std::array<std::array<OVRInput::RawButton, ButtonCount>, 2> const RawButtonsMap = {{
+    {
+        OVRInput::RawButton::X,
+        OVRInput::RawButton::Y,
+        OVRInput::RawButton::LThumbstick,
+        OVRInput::RawButton::LHandTrigger,
+        OVRInput::RawButton::LIndexTrigger,
+        OVRInput::RawButton::Start,
+    },
+    {
+        OVRInput::RawButton::A,
+        OVRInput::RawButton::B,
+        OVRInput::RawButton::RThumbstick,
+        OVRInput::RawButton::RHandTrigger,
+        OVRInput::RawButton::RIndexTrigger,
+        OVRInput::RawButton::None,
+    },
+}};
+
+static constexpr int HistorySize = 8;
+
+namespace {
+    // global event ids, resolved once since they are all registered in setup
+    struct ButtonEvents {
+        std::array<int, ButtonCount> press;
+        std::array<int, ButtonCount> release;
+        std::array<int, ButtonCount> hold;
+        std::array<int, ButtonCount> doubleTap;
+        std::array<int, ButtonCount> longPress;
+
+        ButtonEvents(MetaCore::Input::Controllers controller) {
+            using namespace MetaCore;
+            for (int i = 0; i < ButtonCount; i++) {
+                int id = Input::ButtonEvent(controller, (Input::Buttons) i);
+                press[i] = Events::FindEvent(Input::PressEvents, id);
+                release[i] = Events::FindEvent(Input::ReleaseEvents, id);
+                hold[i] = Events::FindEvent(Input::HoldEvents, id);
+                doubleTap[i] = Events::FindEvent(Input::DoubleTapEvents, id);
+                longPress[i] = Events::FindEvent(Input::LongPressEvents, id);
+            }
+        }
+    };
+
+    struct ButtonHistory {
+        // the most recent edges, with the newest before next
+        std::array<MetaCore::Input::ButtonEdge, HistorySize> edges;
+        int next = 0;
+        int count = 0;
+        // a double tap consumes its first press, so that a triple tap is only one double tap
+        bool tapAvailable = false;
+        bool longPressed = false;
+
+        void Add(bool pressed, float time) {
+            edges[next] = {pressed, time};
+            next = (next + 1) % HistorySize;
+            count = std::min(count + 1, HistorySize);
+        }
+        // the edge from a number of edges ago, with 0 being the newest
+        MetaCore::Input::ButtonEdge const* Get(int back) const {
+            if (back >= count)
+                return nullptr;
+            return &edges[(next - 1 - back + HistorySize) % HistorySize];
+        }
+    };
+
+    struct ControllerState {
+        ControllerState(MetaCore::Input::Controllers controller) : controller(controller) {}
+
+        MetaCore::Input::Controllers const controller;
+        uint32_t buttons = 0;
+        std::array<ButtonHistory, ButtonCount> history = {};
+    };
+
+    struct Chord {
+        int slot;
+        uint32_t mask;
+        float window;
+        int event;
+    };
+}
+
+// Left, Right, then Either as the combination of both
+static std::array<ControllerState, 3> controllerStates = {MetaCore::Input::Left, MetaCore::Input::Right, MetaCore::Input::Either};
+static bool buttonsRead = false;
+
+static std::vector<Chord> chords;
+
+static float doubleTapWindow = 0.3;
+static float longPressDuration = 0.5;
+
+static constexpr int MaxPoseHistory = 512;
+
+namespace {
+    struct NodeState {
+        NodeState(UnityEngine::XR::XRNode node) : node(node) {}
+
+        UnityEngine::XR::XRNode const node;
+        // the pose is only queried once per frame
+        int frame = -1;
+        UnityEngine::Pose pose = {};
+        // a ring of samples, with the newest before next
+        std::vector<MetaCore::Input::PoseSample> history = {};
+        int next = 0;
+        int count = 0;
+
+        void Add(MetaCore::Input::PoseSample sample) {
+            history[next] = sample;
+            next = (next + 1) % history.size();
+            count = std::min<int>(count + 1, history.size());
+        }
+        // the sample from a number of frames ago, with 0 being the newest
+        MetaCore::Input::PoseSample const* Get(int back) const {
+            if (back >= count)
+                return nullptr;
+            int size = history.size();
+            return &history[(next - 1 - back + size) % size];
+        }
+    };
+}
+
+// indexed by the Nodes enum
+static std::array<NodeState, 3> nodeStates = {
+    UnityEngine::XR::XRNode::LeftHand, UnityEngine::XR::XRNode::RightHand, UnityEngine::XR::XRNode::CenterEye
+};
+static std::map<std::string, int> poseHistoryRequests;
+static int poseHistorySize = 0;
+
 static std::set<std::string> hapticsDisablers;
 
+static int GetSlot(MetaCore::Input::Controllers controller) {
+    switch (controller) {
+        case MetaCore::Input::Left:
+            return 0;
+        case MetaCore::Input::Right:
+            return 1;
+        case MetaCore::Input::Either:
+            return 2;
+        default:
+            return -1;
+    }
+}
+
 bool MetaCore::Input::GetPressed(Controllers controller, Buttons button) {
     if (button < 0 || button >= ButtonsMap.size() || controller < 0 || controller >= ControllersMap.size())
         return false;
+    // use the state read once this frame when possible
+    int slot = GetSlot(controller);
+    if (buttonsRead && slot >= 0)
+        return controllerStates[slot].buttons & (1 << button);
     return OVRInput::Get(ButtonsMap[button], ControllersMap[controller]);
 }
 
@@ -50,31 +207,116 @@ UnityEngine::Vector2 MetaCore::Input::GetThumbstick(Controllers controller) {
     return OVRInput::Get(OVRInput::Axis2D::PrimaryThumbstick, ControllersMap[controller]);
 }
 
-static UnityEngine::Pose GetNodePose(UnityEngine::XR::XRNode node) {
-    auto pose = UnityEngine::Pose::get_identity();
-    UnityEngine::SpatialTracking::PoseDataSource::GetNodePoseData(node, byref(pose));
-    return pose;
+static UnityEngine::Pose GetNodePose(MetaCore::Input::Nodes node) {
+    auto& state = nodeStates[node];
+    int frame = UnityEngine::Time::get_frameCount();
+    if (state.frame != frame) {
+        state.pose = UnityEngine::Pose::get_identity();
+        UnityEngine::SpatialTracking::PoseDataSource::GetNodePoseData(state.node, byref(state.pose));
+        state.frame = frame;
+    }
+    return state.pose;
 }
 
 UnityEngine::Pose MetaCore::Input::GetHandPose(bool left) {
-    return GetNodePose(left ? UnityEngine::XR::XRNode::LeftHand : UnityEngine::XR::XRNode::RightHand);
+    return GetNodePose(left ? LeftHand : RightHand);
 }
 
 UnityEngine::Pose MetaCore::Input::GetHeadPose() {
-    return GetNodePose(UnityEngine::XR::XRNode::CenterEye);
+    return GetNodePose(Head);
 }
 
-static VRUIControls::VRInputModule* FindCurrentInputModule() {
-    auto eventSystem = UnityEngine::EventSystems::EventSystem::get_current();
-    if (!eventSystem) {
-        auto eventSystems = UnityEngine::Resources::FindObjectsOfTypeAll<UnityEngine::EventSystems::EventSystem*>();
-        eventSystem = eventSystems->FirstOrDefault([](auto e) { return e->isActiveAndEnabled; });
-        if (!eventSystem)
-            eventSystem = eventSystems->FirstOrDefault();
+void MetaCore::Input::SetPoseHistory(std::string mod, int frames) {
+    if (frames > 0)
+        poseHistoryRequests[mod] = std::min(frames, MaxPoseHistory);
+    else
+        poseHistoryRequests.erase(mod);
+
+    int size = 0;
+    for (auto const& [_, requested] : poseHistoryRequests)
+        size = std::max(size, requested);
+    if (size == poseHistorySize)
+        return;
+    poseHistorySize = size;
+    for (auto& state : nodeStates) {
+        state.history.assign(size, {});
+        state.next = 0;
+        state.count = 0;
+    }
+}
+
+std::vector<MetaCore::Input::PoseSample> MetaCore::Input::GetPoseHistory(Nodes node) {
+    if (node < 0 || node >= nodeStates.size())
+        return {};
+    auto const& state = nodeStates[node];
+    std::vector<PoseSample> ret;
+    ret.reserve(state.count);
+    for (int i = state.count - 1; i >= 0; i--)
+        ret.emplace_back(*state.Get(i));
+    return ret;
+}
+
+// the newest sample and one from a couple frames before, to smooth out uneven frame times
+static std::pair<MetaCore::Input::PoseSample const*, MetaCore::Input::PoseSample const*> GetVelocitySamples(MetaCore::Input::Nodes node) {
+    if (node < 0 || node >= nodeStates.size())
+        return {nullptr, nullptr};
+    auto const& state = nodeStates[node];
+    if (state.count < 2)
+        return {nullptr, nullptr};
+    auto newest = state.Get(0);
+    auto oldest = state.Get(std::min(state.count - 1, 2));
+    if (newest->time <= oldest->time)
+        return {nullptr, nullptr};
+    return {newest, oldest};
+}
+
+UnityEngine::Vector3 MetaCore::Input::GetVelocity(Nodes node) {
+    auto [newest, oldest] = GetVelocitySamples(node);
+    if (!newest)
+        return {};
+    float time = newest->time - oldest->time;
+    auto const& a = newest->pose.position;
+    auto const& b = oldest->pose.position;
+    return {(a.x - b.x) / time, (a.y - b.y) / time, (a.z - b.z) / time};
+}
+
+UnityEngine::Vector3 MetaCore::Input::GetAngularVelocity(Nodes node) {
+    auto [newest, oldest] = GetVelocitySamples(node);
+    if (!newest)
+        return {};
+    auto const& a = newest->pose.rotation;
+    // the inverse of a unit quaternion is its conjugate
+    UnityEngine::Quaternion b = {-oldest->pose.rotation.x, -oldest->pose.rotation.y, -oldest->pose.rotation.z, oldest->pose.rotation.w};
+    // the world space rotation between the samples, a * b
+    float x = a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y;
+    float y = a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x;
+    float z = a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w;
+    float w = a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z;
+    // take the shorter way around
+    if (w < 0) {
+        x = -x;
+        y = -y;
+        z = -z;
+        w = -w;
     }
-    if (!eventSystem)
-        return nullptr;
-    return eventSystem->GetComponent<VRUIControls::VRInputModule*>();
+    float length = std::sqrt(x * x + y * y + z * z);
+    if (length < 1e-6)
+        return {};
+    float scale = 2 * std::atan2(length, w) / length / (newest->time - oldest->time);
+    return {x * scale, y * scale, z * scale};
+}
+
+static VRUIControls::VRInputModule* FindCurrentInputModule() {
+    if (auto eventSystem = UnityEngine::EventSystems::EventSystem::get_current())
+        return eventSystem->GetComponent<VRUIControls::VRInputModule*>();
+    auto module = Services::Get<VRUIControls::VRInputModule>();
+    if (!module || module->isActiveAndEnabled)
+        return module;
+    // the bound module can belong to a disabled menu, so prefer an enabled one like the current event system would be
+    auto modules = UnityEngine::Resources::FindObjectsOfTypeAll<VRUIControls::VRInputModule*>();
+    if (auto enabled = modules->FirstOrDefault([](auto m) { return m->isActiveAndEnabled; }))
+        return enabled;
+    return module;
 }
 
 VRUIControls::VRInputModule* MetaCore::Input::GetCurrentInputModule() {
@@ -101,3 +343,163 @@ bool MetaCore::Input::IsHapticsDisabled() {
 std::set<std::string> const& MetaCore::Input::GetHapticsDisablers() {
     return hapticsDisablers;
 }
+
+
+std::vector<MetaCore::Input::ButtonEdge> MetaCore::Input::GetButtonHistory(Controllers controller, Buttons button) {
+    int slot = GetSlot(controller);
+    if (slot < 0 || button < 0 || button >= ButtonCount)
+        return {};
+    auto const& history = controllerStates[slot].history[button];
+    std::vector<ButtonEdge> ret;
+    ret.reserve(history.count);
+    for (int i = history.count - 1; i >= 0; i--)
+        ret.emplace_back(*history.Get(i));
+    return ret;
+}
+
+float MetaCore::Input::GetHeldTime(Controllers controller, Buttons button) {
+    int slot = GetSlot(controller);
+    if (slot < 0 || button < 0 || button >= ButtonCount || !(controllerStates[slot].buttons & (1 << button)))
+        return 0;
+    return UnityEngine::Time::get_unscaledTime() - controllerStates[slot].history[button].Get(0)->time;
+}
+
+void MetaCore::Input::SetGestureTiming(float doubleTapSeconds, float longPressSeconds) {
+    doubleTapWindow = std::max(doubleTapSeconds, 0.f);
+    longPressDuration = std::max(longPressSeconds, 0.f);
+}
+
+int MetaCore::Input::RegisterChord(Controllers controller, std::vector<Buttons> buttons, float window) {
+    int slot = GetSlot(controller);
+    uint32_t mask = 0;
+    for (auto button : buttons) {
+        if (button < 0 || button >= ButtonCount)
+            return -1;
+        mask |= 1 << button;
+    }
+    if (slot < 0 || std::popcount(mask) < 2)
+        return -1;
+    window = std::max(window, 0.f);
+
+    for (auto const& chord : chords) {
+        if (chord.slot == slot && chord.mask == mask && chord.window == window)
+            return chord.event;
+    }
+    int event = Events::RegisterEvent(ChordEvents, chords.size());
+    if (event >= 0)
+        chords.emplace_back(slot, mask, window, event);
+    return event;
+}
+
+// reads the buttons of both controllers into masks indexed by the Buttons enum
+static std::array<uint32_t, 2> ReadButtons() {
+    static OVRInput::RawButton const anyButton = [] {
+        OVRInput::RawButton ret = OVRInput::RawButton::None;
+        for (auto const& buttons : RawButtonsMap) {
+            for (auto button : buttons)
+                ret = ret | button;
+        }
+        return ret;
+    }();
+
+    std::array<uint32_t, 2> ret = {};
+    // a combined mask checks if any of them are pressed, so the usual case of no buttons held only needs one read
+    if (!OVRInput::Get(anyButton, OVRInput::Controller::Touch))
+        return ret;
+    for (int controller = 0; controller < 2; controller++) {
+        for (int i = 0; i < ButtonCount; i++) {
+            auto button = RawButtonsMap[controller][i];
+            if (button != OVRInput::RawButton::None && OVRInput::Get(button, OVRInput::Controller::Touch))
+                ret[controller] |= 1 << i;
+        }
+    }
+    return ret;
+}
+
+static void RecordEdges(ControllerState& state, uint32_t previous, float time) {
+    uint32_t changed = state.buttons ^ previous;
+    for (int i = 0; i < ButtonCount; i++) {
+        if (changed & (1 << i))
+            state.history[i].Add(state.buttons & (1 << i), time);
+    }
+}
+
+static void BroadcastEdges(ControllerState& state, uint32_t previous, float time) {
+    static std::array<ButtonEvents, 3> const events = {MetaCore::Input::Left, MetaCore::Input::Right, MetaCore::Input::Either};
+    auto const& ids = events[GetSlot(state.controller)];
+
+    uint32_t current = state.buttons;
+    uint32_t changed = current ^ previous;
+
+    for (int i = 0; i < ButtonCount; i++) {
+        uint32_t bit = 1 << i;
+        auto& history = state.history[i];
+        if (changed & current & bit) {
+            history.longPressed = false;
+            MetaCore::Events::Broadcast(ids.press[i]);
+            // the previous press is two edges back, with its release between
+            auto lastPress = history.Get(2);
+            if (history.tapAvailable && lastPress && time - lastPress->time <= doubleTapWindow) {
+                history.tapAvailable = false;
+                MetaCore::Events::Broadcast(ids.doubleTap[i]);
+            } else
+                history.tapAvailable = true;
+        }
+        if (current & bit) {
+            MetaCore::Events::Broadcast(ids.hold[i]);
+            if (!history.longPressed && time - history.Get(0)->time >= longPressDuration) {
+                history.longPressed = true;
+                MetaCore::Events::Broadcast(ids.longPress[i]);
+            }
+        }
+        if (changed & previous & bit)
+            MetaCore::Events::Broadcast(ids.release[i]);
+    }
+}
+
+static void UpdateChords(std::array<uint32_t, 3> const& previous) {
+    for (auto const& chord : chords) {
+        auto const& state = controllerStates[chord.slot];
+        if ((state.buttons & chord.mask) != chord.mask || (previous[chord.slot] & chord.mask) == chord.mask)
+            continue;
+        if (chord.window > 0) {
+            float first = std::numeric_limits<float>::max();
+            float last = 0;
+            for (int i = 0; i < ButtonCount; i++) {
+                if (!(chord.mask & (1 << i)))
+                    continue;
+                float time = state.history[i].Get(0)->time;
+                first = std::min(first, time);
+                last = std::max(last, time);
+            }
+            if (last - first > chord.window)
+                continue;
+        }
+        MetaCore::Events::Broadcast(chord.event);
+    }
+}
+
+void MetaCore::Internals::UpdateInput() {
+    auto current = ReadButtons();
+    float time = UnityEngine::Time::get_unscaledTime();
+    std::array<uint32_t, 3> masks = {current[0], current[1], current[0] | current[1]};
+
+    // update all the state before any callbacks, so they see the same state for every controller
+    std::array<uint32_t, 3> previous;
+    for (int i = 0; i < 3; i++) {
+        previous[i] = controllerStates[i].buttons;
+        controllerStates[i].buttons = masks[i];
+        RecordEdges(controllerStates[i], previous[i], time);
+    }
+    buttonsRead = true;
+
+    // either first, as it was the only one before
+    for (int i : {2, 0, 1})
+        BroadcastEdges(controllerStates[i], previous[i], time);
+    UpdateChords(previous);
+
+    if (poseHistorySize == 0)
+        return;
+    for (int i = 0; i < nodeStates.size(); i++)
+        nodeStates[i].Add({GetNodePose((Input::Nodes) i), time});
+}
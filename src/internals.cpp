@@ -1,5 +1,7 @@
 #include "internals.hpp"
 
+#include <chrono>
+
 #include "GlobalNamespace/AudioTimeSyncController.hpp"
 #include "GlobalNamespace/BeatmapCallbacksUpdater.hpp"
 #include "GlobalNamespace/BeatmapDataSortedListForTypeAndIds_1.hpp"
@@ -22,6 +24,7 @@
 #include "UnityEngine/Resources.hpp"
 #include "UnityEngine/Time.hpp"
 #include "UnityEngine/Transform.hpp"
+#include "Zenject/DiContainer.hpp"
 #include "delegates.hpp"
 #include "events.hpp"
 #include "main.hpp"
@@ -36,41 +39,53 @@ using namespace UnityEngine;
 static std::string lastBeatmap;
 static float timeSinceSlowUpdate;
 
-static std::pair<int, int> GetNoteCount(BeatmapCallbacksUpdater* updater, bool left) {
-    using LinkedList = System::Collections::Generic::LinkedList_1<NoteData*>;
+namespace {
+    struct NoteCounts {
+        int remainingLeft = 0;
+        int totalLeft = 0;
+        int remainingRight = 0;
+        int totalRight = 0;
+    };
+}
 
-    if (!updater)
-        return {0, 0};
+// counts both colors in a single pass over the notes
+static NoteCounts GetNoteCounts(BeatmapCallbacksController* controller) {
+    using LinkedList = System::Collections::Generic::LinkedList_1<NoteData*>;
 
-    int noteCount = 0;
-    int totalCount = 0;
+    NoteCounts ret;
+    if (!controller)
+        return ret;
 
-    auto bcc = updater->_beatmapCallbacksController;
-    auto songTime = bcc->_startFilterTime;
+    auto songTime = controller->_startFilterTime;
 
-    auto data = il2cpp_utils::try_cast<BeatmapData>(bcc->_beatmapData).value_or(nullptr);
+    auto data = il2cpp_utils::try_cast<BeatmapData>(controller->_beatmapData).value_or(nullptr);
     if (!data) {
-        logger.warn("IReadonlyBeatmapData was {} not BeatmapData", il2cpp_functions::class_get_name(((Il2CppObject*) bcc->_beatmapData)->klass));
-        return {0, 0};
+        logger.warn("IReadonlyBeatmapData was {} not BeatmapData", il2cpp_functions::class_get_name(((Il2CppObject*) controller->_beatmapData)->klass));
+        return ret;
     }
 
     auto noteDataItemsList = (LinkedList*) data->_beatmapDataItemsPerTypeAndId->GetList(csTypeOf(NoteData*), 0)->items;
     auto enumerator = noteDataItemsList->GetEnumerator();
     while (enumerator.MoveNext()) {
         auto noteData = (NoteData*) enumerator.Current;
-        if (Stats::ShouldCountNote(noteData) && (noteData->colorType == ColorType::ColorA) == left) {
-            totalCount++;
-            if (noteData->time >= songTime)
-                noteCount++;
+        if (!Stats::ShouldCountNote(noteData))
+            continue;
+        bool remaining = noteData->time >= songTime;
+        if (noteData->colorType == ColorType::ColorA) {
+            ret.totalLeft++;
+            ret.remainingLeft += remaining;
+        } else {
+            ret.totalRight++;
+            ret.remainingRight += remaining;
         }
     }
-    return {noteCount, totalCount};
+    return ret;
 }
 
-static int GetMaxScore(BeatmapCallbacksUpdater* updater) {
-    if (!updater)
+static int GetMaxScore(BeatmapCallbacksController* controller) {
+    if (!controller)
         return 0;
-    return ScoreModel::ComputeMaxMultipliedScoreForBeatmap(updater->_beatmapCallbacksController->_beatmapData);
+    return ScoreModel::ComputeMaxMultipliedScoreForBeatmap(controller->_beatmapData);
 }
 
 static float GetSongLength(ScoreController* controller) {
@@ -136,7 +151,33 @@ static float GetHealth(ScoreController* controller) {
     return controller->_gameEnergyCounter->energy;
 }
 
-static GameplayCoreSceneSetupData* FindSceneSetupData() {
+// resolves a reference from the scene container, only searching every object if it isn't bound there
+template <class T>
+static T* Resolve(Zenject::DiContainer* container, int& searches) {
+    if (container) {
+        if (auto ret = container->TryResolve<T*>())
+            return ret;
+    }
+    searches++;
+    return Object::FindObjectOfType<T*>(true);
+}
+
+static BeatmapCallbacksController* ResolveCallbacksController(Zenject::DiContainer* container, int& searches) {
+    if (container) {
+        if (auto ret = container->TryResolve<BeatmapCallbacksController*>())
+            return ret;
+    }
+    searches++;
+    auto updater = Object::FindObjectOfType<BeatmapCallbacksUpdater*>(true);
+    return updater ? updater->_beatmapCallbacksController : nullptr;
+}
+
+static GameplayCoreSceneSetupData* FindSceneSetupData(Zenject::DiContainer* container, int& searches) {
+    if (container) {
+        if (auto ret = container->TryResolve<GameplayCoreSceneSetupData*>())
+            return ret;
+    }
+    searches++;
     auto gameplayCoreInstallers = Resources::FindObjectsOfTypeAll<GameplayCoreInstaller*>();
     for (auto& installer : gameplayCoreInstallers) {
         if (installer->isActiveAndEnabled && installer->_sceneSetupData != nullptr)
@@ -224,39 +265,48 @@ bool Internals::referencesValid = false;
 bool Internals::mapWasQuit = false;
 bool Internals::mapWasRestarted = false;
 
+// kept separately so that mods built against the version without a container still load
 void Internals::Initialize() {
-    auto beatmapCallbacksUpdater = Object::FindObjectOfType<BeatmapCallbacksUpdater*>(true);
-    auto playerDataModel = Object::FindObjectOfType<PlayerDataModel*>(true);
+    Initialize(nullptr);
+}
+
+void Internals::Initialize(Zenject::DiContainer* container) {
+    using Clock = std::chrono::steady_clock;
+    using Milliseconds = std::chrono::duration<float, std::milli>;
+    auto start = Clock::now();
+    int searches = 0;
+
+    auto playerDataModel = Resolve<PlayerDataModel>(container, searches);
 
-    auto setupData = FindSceneSetupData();
+    auto setupData = FindSceneSetupData(container, searches);
 
-    // out of order since we use it
-    scoreController = Object::FindObjectOfType<ScoreController*>(true);
+    // out of order since we use them
+    scoreController = Resolve<ScoreController>(container, searches);
+    beatmapCallbacksController = ResolveCallbacksController(container, searches);
 
     modifiers = scoreController ? scoreController->_gameplayModifiers : nullptr;
 
     colors = setupData ? setupData->colorScheme : nullptr;
     beatmapLevel = setupData ? setupData->beatmapLevel : nullptr;
     beatmapKey = setupData ? setupData->beatmapKey : BeatmapKey();
-    beatmapData = beatmapCallbacksUpdater ? (BeatmapData*) beatmapCallbacksUpdater->_beatmapCallbacksController->_beatmapData : nullptr;
+    beatmapData = beatmapCallbacksController ? (BeatmapData*) beatmapCallbacksController->_beatmapData : nullptr;
     environment = setupData ? setupData->targetEnvironmentInfo : nullptr;
 
     audioTimeSyncController = scoreController ? scoreController->_audioTimeSyncController : nullptr;
-    beatmapCallbacksController = beatmapCallbacksUpdater ? beatmapCallbacksUpdater->_beatmapCallbacksController : nullptr;
     beatmapObjectManager = scoreController ? scoreController->_beatmapObjectManager : nullptr;
-    comboController = Object::FindObjectOfType<ComboController*>(true);
+    comboController = Resolve<ComboController>(container, searches);
     gameEnergyCounter = scoreController ? il2cpp_utils::try_cast<GameEnergyCounter>(scoreController->_gameEnergyCounter).value_or(nullptr) : nullptr;
-    saberManager = Object::FindObjectOfType<SaberManager*>(true);
+    saberManager = Resolve<SaberManager>(container, searches);
     mainCamera = Camera::get_main();
 
-    referencesValid = setupData && scoreController && beatmapCallbacksUpdater && comboController && gameEnergyCounter && saberManager && mainCamera;
+    referencesValid = setupData && scoreController && beatmapCallbacksController && comboController && gameEnergyCounter && saberManager && mainCamera;
 
     if (!referencesValid)
         logger.critical(
             "Not all expected references were found! Got: {} {} {} {} {} {} {}",
             (bool) setupData,
             (bool) scoreController,
-            (bool) beatmapCallbacksUpdater,
+            (bool) beatmapCallbacksController,
             (bool) comboController,
             (bool) gameEnergyCounter,
             (bool) saberManager,
@@ -271,11 +321,13 @@ void Internals::Initialize() {
             multiplierProgress = normalizedProgress * mult * 2;
         }));
 
+    auto resolved = Clock::now();
+
     leftScore = 0;
     rightScore = 0;
     leftMaxScore = 0;
     rightMaxScore = 0;
-    songMaxScore = GetMaxScore(beatmapCallbacksUpdater);
+    songMaxScore = GetMaxScore(beatmapCallbacksController);
     leftCombo = 0;
     rightCombo = 0;
     combo = 0;
@@ -299,12 +351,13 @@ void Internals::Initialize() {
     wallsHit = 0;
     uncountedNotesLeftCut = 0;
     uncountedNotesRightCut = 0;
-    auto pair = GetNoteCount(beatmapCallbacksUpdater, true);
-    remainingNotesLeft = pair.first;
-    songNotesLeft = pair.second;
-    pair = GetNoteCount(beatmapCallbacksUpdater, false);
-    remainingNotesRight = pair.first;
-    songNotesRight = pair.second;
+    auto scored = Clock::now();
+    auto counts = GetNoteCounts(beatmapCallbacksController);
+    remainingNotesLeft = counts.remainingLeft;
+    songNotesLeft = counts.totalLeft;
+    remainingNotesRight = counts.remainingRight;
+    songNotesRight = counts.totalRight;
+    auto counted = Clock::now();
     leftPreSwing = 0;
     rightPreSwing = 0;
     leftPostSwing = 0;
@@ -345,6 +398,15 @@ void Internals::Initialize() {
     prevRotRight = Quaternion::get_identity();
 
     stateValid = true;
+
+    logger.info(
+        "scene start took {:.2f} ms: references {:.2f} ms with {} searches, max score {:.2f} ms, note counts {:.2f} ms",
+        Milliseconds(Clock::now() - start).count(),
+        Milliseconds(resolved - start).count(),
+        searches,
+        Milliseconds(scored - resolved).count(),
+        Milliseconds(counted - scored).count()
+    );
 }
 
 void Internals::DoSlowUpdate() {
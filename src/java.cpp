@@ -1,193 +1,384 @@
 #include "java.hpp"
 
+#include <pthread.h>
+
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
 #include "jtypes.hpp"
 #include "main.hpp"
 
-struct cleanup {
-    cleanup(std::function<void()> fn) : fn(fn) {}
-    ~cleanup() { fn(); }
+void MetaCore::Java::CheckException(JNIEnv* env) {
+    if (!env->ExceptionCheck())
+        return;
+    jthrowable exc = env->ExceptionOccurred();
+    env->ExceptionClear();
+    logger.warn("JNI error: {}", DescribeError(env, exc));
+    std::string message = ToString(env, exc);
+    env->DeleteLocalRef(exc);
+    throw std::runtime_error(message);
+}
+
+static std::shared_mutex classesMutex;
+static std::unordered_map<std::string, jclass> classes;
+
+static jclass FindNamedClass(JNIEnv* env, std::string const& name) {
+    std::shared_lock readLock(classesMutex);
+    if (auto found = classes.find(name); found != classes.end())
+        return found->second;
+    readLock.unlock();
+
+    jclass local = env->FindClass(name.c_str());
+    MetaCore::Java::CheckException(env);
+    if (!local)
+        return nullptr;
+    jclass global = (jclass) env->NewGlobalRef(local);
+    env->DeleteLocalRef(local);
+
+    std::unique_lock writeLock(classesMutex);
+    auto [found, added] = classes.emplace(name, global);
+    if (!added)
+        env->DeleteGlobalRef(global);
+    return found->second;
+}
+
+// a class for a single call, deleting it afterwards if it was a new local ref
+struct ClassRef {
+    ClassRef(JNIEnv* env) : env(env) {}
+    ClassRef(ClassRef const&) = delete;
+    ~ClassRef() {
+        if (local)
+            env->DeleteLocalRef(clazz);
+    }
+
+    void Find(MetaCore::Java::FindClass const& find) {
+        if (find.clazz)
+            clazz = find.clazz;
+        else if (find.instance) {
+            clazz = env->GetObjectClass(find.instance);
+            local = clazz != nullptr;
+        } else if (!find.name.empty())
+            clazz = FindNamedClass(env, find.name);
+    }
+
+    JNIEnv* env;
+    jclass clazz = nullptr;
+    bool local = false;
+};
+
+// ids are cached per member, with the class name included when known, but otherwise compared as
+// different subclasses can be passed for the same member name and signature
+template <class T>
+struct MemberCache {
+    template <class F>
+    T Get(JNIEnv* env, jclass clazz, std::string const& className, std::string const& name, std::string const& signature, bool isStatic, F lookup) {
+        thread_local std::string key;
+        key.clear();
+        key.append(className).append(1, ' ').append(name).append(1, ' ').append(signature).append(1, isStatic ? 'S' : 'I');
+
+        std::shared_lock readLock(mutex);
+        if (auto found = members.find(key); found != members.end()) {
+            for (auto& [cachedClass, id] : found->second) {
+                if (cachedClass == clazz || env->IsSameObject(cachedClass, clazz))
+                    return id;
+            }
+        }
+        readLock.unlock();
+
+        T id = lookup();
+        MetaCore::Java::CheckException(env);
+        if (!id)
+            return nullptr;
 
-    std::function<void()> fn;
+        std::unique_lock writeLock(mutex);
+        members[key].emplace_back((jclass) env->NewGlobalRef(clazz), id);
+        return id;
+    }
+
+   private:
+    std::shared_mutex mutex;
+    std::unordered_map<std::string, std::vector<std::pair<jclass, T>>> members;
+};
+
+static MemberCache<jmethodID> methods;
+static MemberCache<jfieldID> fields;
+
+static jmethodID FindMethod(JNIEnv* env, jclass clazz, std::string const& className, MetaCore::Java::FindMethodID const& method, bool isStatic) {
+    if (method.method)
+        return method.method;
+    if (!clazz || method.name.empty() || method.signature.empty())
+        return nullptr;
+    return methods.Get(env, clazz, className, method.name, method.signature, isStatic, [&]() {
+        if (isStatic)
+            return env->GetStaticMethodID(clazz, method.name.c_str(), method.signature.c_str());
+        return env->GetMethodID(clazz, method.name.c_str(), method.signature.c_str());
+    });
+}
+
+static jfieldID FindField(JNIEnv* env, jclass clazz, std::string const& className, MetaCore::Java::FindFieldID const& field, bool isStatic) {
+    if (field.field)
+        return field.field;
+    if (!clazz || field.name.empty() || field.signature.empty())
+        return nullptr;
+    return fields.Get(env, clazz, className, field.name, field.signature, isStatic, [&]() {
+        if (isStatic)
+            return env->GetStaticFieldID(clazz, field.name.c_str(), field.signature.c_str());
+        return env->GetFieldID(clazz, field.name.c_str(), field.signature.c_str());
+    });
+}
+
+// detaches threads attached by GetEnv when they exit, but leaves threads that were already attached
+struct ThreadAttachment {
+    ~ThreadAttachment() {
+        if (attached)
+            modloader_jvm->DetachCurrentThread();
+    }
+
+    JNIEnv* env = nullptr;
+    bool attached = false;
 };
 
-#define EXCEPTION_CLEANUP                                          \
-    cleanup exceptionCleanup([env]() {                             \
-        if (env->ExceptionCheck()) {                               \
-            jthrowable exc = env->ExceptionOccurred();             \
-            env->ExceptionClear();                                 \
-            logger.warn("JNI error: {}", DescribeError(env, exc)); \
-            throw std::runtime_error(ToString(env, exc));          \
-        }                                                          \
-    })
-
-#define GET_VA(arg)    \
-    va_list va;        \
-    va_start(va, arg); \
-    cleanup vaCleanup([&va]() { va_end(va); })
+static thread_local ThreadAttachment attachment;
 
 JNIEnv* MetaCore::Java::GetEnv() {
-    JNIEnv* env;
+    if (attachment.env)
+        return attachment.env;
+
+    JNIEnv* env = nullptr;
+    if (modloader_jvm->GetEnv((void**) &env, JNI_VERSION_1_6) == JNI_OK) {
+        attachment.env = env;
+        return env;
+    }
+
+    // keep the native thread name for java stack traces
+    char name[16] = {};
+    pthread_getname_np(pthread_self(), name, sizeof(name));
 
     JavaVMAttachArgs args;
     args.version = JNI_VERSION_1_6;
-    args.name = NULL;
+    args.name = name;
     args.group = NULL;
 
-    modloader_jvm->AttachCurrentThread(&env, &args);
-
+    if (modloader_jvm->AttachCurrentThread(&env, &args) != JNI_OK)
+        return nullptr;
+    attachment.env = env;
+    attachment.attached = true;
     return env;
 }
 
 jclass MetaCore::Java::GetClass(JNIEnv* env, FindClass clazz) {
     if (clazz.clazz)
         return clazz.clazz;
-    EXCEPTION_CLEANUP;
-    if (clazz.instance)
-        return env->GetObjectClass(clazz.instance);
+    if (clazz.instance) {
+        jclass ret = env->GetObjectClass(clazz.instance);
+        CheckException(env);
+        return ret;
+    }
     if (!clazz.name.empty())
-        return env->FindClass(clazz.name.c_str());
+        return FindNamedClass(env, clazz.name);
     return nullptr;
 }
 
 jmethodID MetaCore::Java::GetMethodID(JNIEnv* env, FindClass clazz, FindMethodID method) {
     if (method.method)
         return method.method;
-    jclass foundClass = GetClass(env, clazz);
-    if (!foundClass || method.name.empty() || method.signature.empty())
-        return nullptr;
-    EXCEPTION_CLEANUP;
-    if (clazz.instance)
-        return env->GetMethodID(foundClass, method.name.c_str(), method.signature.c_str());
-    else
-        return env->GetStaticMethodID(foundClass, method.name.c_str(), method.signature.c_str());
-    // delete local ref of class?
+    ClassRef foundClass(env);
+    foundClass.Find(clazz);
+    return FindMethod(env, foundClass.clazz, clazz.name, method, !clazz.instance);
 }
 
 jfieldID MetaCore::Java::GetFieldID(JNIEnv* env, FindClass clazz, FindFieldID field) {
     if (field.field)
         return field.field;
-    jclass foundClass = GetClass(env, clazz);
-    if (!foundClass || field.name.empty() || field.signature.empty())
-        return nullptr;
-    EXCEPTION_CLEANUP;
-    if (clazz.instance)
-        return env->GetFieldID(foundClass, field.name.c_str(), field.signature.c_str());
-    else
-        return env->GetStaticFieldID(foundClass, field.name.c_str(), field.signature.c_str());
+    ClassRef foundClass(env);
+    foundClass.Find(clazz);
+    return FindField(env, foundClass.clazz, clazz.name, field, !clazz.instance);
 }
 
 jobject MetaCore::Java::NewObject(JNIEnv* env, FindClass clazz, FindMethodID init, ...) {
-    GET_VA(init);
-    auto foundClass = GetClass(env, clazz);
-    auto foundMethod = GetMethodID(env, {foundClass, foundClass}, init);
-    if (!foundClass || !foundMethod)
+    ClassRef foundClass(env);
+    foundClass.Find(clazz);
+    auto foundMethod = FindMethod(env, foundClass.clazz, clazz.name, init, false);
+    if (!foundClass.clazz || !foundMethod)
         return nullptr;
-    EXCEPTION_CLEANUP;
-    return env->NewObjectV(foundClass, foundMethod, va);
+    va_list va;
+    va_start(va, init);
+    jobject ret = env->NewObjectV(foundClass.clazz, foundMethod, va);
+    va_end(va);
+    CheckException(env);
+    return ret;
 }
 
 jobject MetaCore::Java::NewObject(JNIEnv* env, FindClass clazz, std::string init, ...) {
-    GET_VA(init);
-    auto foundClass = GetClass(env, clazz);
-    auto foundMethod = GetMethodID(env, {foundClass, foundClass}, {"<init>", init});
-    if (!foundClass || !foundMethod)
+    ClassRef foundClass(env);
+    foundClass.Find(clazz);
+    auto foundMethod = FindMethod(env, foundClass.clazz, clazz.name, {"<init>", init}, false);
+    if (!foundClass.clazz || !foundMethod)
         return nullptr;
-    EXCEPTION_CLEANUP;
-    return env->NewObjectV(foundClass, foundMethod, va);
+    va_list va;
+    va_start(va, init);
+    jobject ret = env->NewObjectV(foundClass.clazz, foundMethod, va);
+    va_end(va);
+    CheckException(env);
+    return ret;
 }
 
 template <class T>
 T MetaCore::Java::RunMethod(JNIEnv* env, FindClass clazz, FindMethodID method, ...) {
-    GET_VA(method);
-    EXCEPTION_CLEANUP;
-    if (clazz.instance) {
-        auto foundMethod = GetMethodID(env, clazz, method);
-        if constexpr (std::is_same_v<T, void>)
-            std::invoke(TypeResolver<T>::JMethod, env, clazz.instance, foundMethod, va);
+    bool isStatic = !clazz.instance;
+    ClassRef foundClass(env);
+    // instance methods don't need the class if the id is already known
+    if (isStatic || !method.method)
+        foundClass.Find(clazz);
+    auto foundMethod = FindMethod(env, foundClass.clazz, clazz.name, method, isStatic);
+    if (!foundMethod || (isStatic && !foundClass.clazz))
+        return T();
+
+    va_list va;
+    va_start(va, method);
+    if constexpr (std::is_same_v<T, void>) {
+        if (isStatic)
+            std::invoke(TypeResolver<T>::JStaticMethod, env, foundClass.clazz, foundMethod, va);
         else
-            return (T) std::invoke(TypeResolver<T>::JMethod, env, clazz.instance, foundMethod, va);
+            std::invoke(TypeResolver<T>::JMethod, env, clazz.instance, foundMethod, va);
+        va_end(va);
+        CheckException(env);
     } else {
-        auto foundClass = GetClass(env, clazz);
-        auto foundMethod = GetMethodID(env, foundClass, method);
-        if constexpr (std::is_same_v<T, void>)
-            std::invoke(TypeResolver<T>::JStaticMethod, env, foundClass, foundMethod, va);
+        T ret;
+        if (isStatic)
+            ret = (T) std::invoke(TypeResolver<T>::JStaticMethod, env, foundClass.clazz, foundMethod, va);
         else
-            return (T) std::invoke(TypeResolver<T>::JStaticMethod, env, foundClass, foundMethod, va);
+            ret = (T) std::invoke(TypeResolver<T>::JMethod, env, clazz.instance, foundMethod, va);
+        va_end(va);
+        CheckException(env);
+        return ret;
     }
 }
 
 template <class T>
 T MetaCore::Java::GetField(JNIEnv* env, FindClass clazz, FindFieldID field) {
-    EXCEPTION_CLEANUP;
-    if (clazz.instance) {
-        auto foundField = GetFieldID(env, clazz, field);
-        return (T) std::invoke(TypeResolver<T>::JGetField, env, clazz.instance, foundField);
-    } else {
-        auto foundClass = GetClass(env, clazz);
-        auto foundField = GetFieldID(env, foundClass, field);
-        return (T) std::invoke(TypeResolver<T>::JGetStaticField, env, foundClass, foundField);
-    }
+    bool isStatic = !clazz.instance;
+    ClassRef foundClass(env);
+    if (isStatic || !field.field)
+        foundClass.Find(clazz);
+    auto foundField = FindField(env, foundClass.clazz, clazz.name, field, isStatic);
+    if (!foundField || (isStatic && !foundClass.clazz))
+        return T();
+
+    T ret;
+    if (isStatic)
+        ret = (T) std::invoke(TypeResolver<T>::JGetStaticField, env, foundClass.clazz, foundField);
+    else
+        ret = (T) std::invoke(TypeResolver<T>::JGetField, env, clazz.instance, foundField);
+    CheckException(env);
+    return ret;
 }
 
 template <class T>
 void MetaCore::Java::SetField(JNIEnv* env, FindClass clazz, FindFieldID field, T value) {
-    EXCEPTION_CLEANUP;
-    if (clazz.instance) {
-        auto foundField = GetFieldID(env, clazz, field);
+    bool isStatic = !clazz.instance;
+    ClassRef foundClass(env);
+    if (isStatic || !field.field)
+        foundClass.Find(clazz);
+    auto foundField = FindField(env, foundClass.clazz, clazz.name, field, isStatic);
+    if (!foundField || (isStatic && !foundClass.clazz))
+        return;
+
+    if (isStatic)
+        std::invoke(TypeResolver<T>::JSetStaticField, env, foundClass.clazz, foundField, value);
+    else
         std::invoke(TypeResolver<T>::JSetField, env, clazz.instance, foundField, value);
-    } else {
-        auto foundClass = GetClass(env, clazz);
-        auto foundField = GetFieldID(env, foundClass, field);
-        std::invoke(TypeResolver<T>::JSetStaticField, env, foundClass, foundField, value);
-    }
+    CheckException(env);
+}
+
+bool MetaCore::Java::MethodHandle::Resolve(JNIEnv* env, std::string_view signature, bool isStatic) {
+    if (id.load(std::memory_order_acquire))
+        return true;
+    jclass foundClass = GetClass(env, {className});
+    if (!foundClass)
+        return false;
+    FindClass find = isStatic ? FindClass(foundClass) : FindClass(foundClass, foundClass);
+    jmethodID foundMethod = GetMethodID(env, find, {name, std::string(signature)});
+    if (!foundMethod)
+        return false;
+    clazz.store(foundClass, std::memory_order_relaxed);
+    id.store(foundMethod, std::memory_order_release);
+    return true;
 }
 
 jclass MetaCore::Java::LoadClass(JNIEnv* env, std::string name, std::string_view dexBytes) {
+    using ClassLoader = JavaObject<"java/lang/ClassLoader">;
+    static JavaMethod<ClassLoader()> getClassLoader("java/lang/Class", "getClassLoader");
+    static JavaConstructor<JavaObject<"java/nio/ByteBuffer">, ClassLoader> newDexClassLoader("dalvik/system/InMemoryDexClassLoader");
+    static JavaMethod<jclass(jstring)> loadClass("java/lang/ClassLoader", "loadClass");
+
     JNIFrame frame(env, 5);
 
-    auto dexBuffer = env->NewDirectByteBuffer((void*) dexBytes.data(), dexBytes.length() - 1);
+    auto dexBuffer = NewDirectBuffer(env, {(uint8_t*) dexBytes.data(), dexBytes.length() - 1});
 
     // not sure if necessary to run this on the UnityPlayer class
-    auto baseClassLoader = RunMethod<jobject>(
-        env, {GetClass(env, {"java/lang/Class"}), GetClass(env, {"com/unity3d/player/UnityPlayer"})}, {"getClassLoader", "()Ljava/lang/ClassLoader;"}
-    );
+    auto baseClassLoader = getClassLoader(env, GetClass(env, {"com/unity3d/player/UnityPlayer"}));
 
-    auto classLoader =
-        NewObject(env, {"dalvik/system/InMemoryDexClassLoader"}, "(Ljava/nio/ByteBuffer;Ljava/lang/ClassLoader;)V", dexBuffer, baseClassLoader);
+    auto classLoader = newDexClassLoader(env, dexBuffer, baseClassLoader);
 
-    auto loadedClass = RunMethod<jobject>(env, classLoader, {"loadClass", "(Ljava/lang/String;)Ljava/lang/Class;"}, env->NewStringUTF(name.c_str()));
+    auto loadedClass = loadClass(env, classLoader, env->NewStringUTF(name.c_str()));
 
     return (jclass) env->NewGlobalRef(loadedClass);
 }
 
+jobject MetaCore::Java::NewDirectBuffer(JNIEnv* env, std::span<uint8_t> data) {
+    return env->NewDirectByteBuffer(data.data(), data.size());
+}
+
+std::span<uint8_t> MetaCore::Java::GetDirectBuffer(JNIEnv* env, jobject buffer) {
+    if (!buffer)
+        return {};
+    auto data = (uint8_t*) env->GetDirectBufferAddress(buffer);
+    auto size = env->GetDirectBufferCapacity(buffer);
+    if (!data || size < 0)
+        return {};
+    return {data, (size_t) size};
+}
+
+jbyteArray MetaCore::Java::NewByteArray(JNIEnv* env, std::span<uint8_t const> data) {
+    jbyteArray array = env->NewByteArray(data.size());
+    CheckException(env);
+    env->SetByteArrayRegion(array, 0, data.size(), (jbyte const*) data.data());
+    return array;
+}
+
 std::string MetaCore::Java::ConvertString(JNIEnv* env, jstring string) {
-    if (!string)
-        return "";
-    char const* chars = env->GetStringUTFChars(string, nullptr);
-    int length = env->GetStringUTFLength(string);
-    std::string ret(chars, length);
-    env->ReleaseStringUTFChars(string, chars);
-    return ret;
+    return std::string(StringChars(env, string).view());
 }
 
 std::string MetaCore::Java::ToString(JNIEnv* env, jobject object) {
-    jstring string = RunMethod<jstring>(env, object, {"toString", "()Ljava/lang/String;"});
+    static JavaMethod<jstring()> toString("java/lang/Object", "toString");
+
+    jstring string = toString(env, object);
     std::string ret = ConvertString(env, string);
     env->DeleteLocalRef(string);
     return ret;
 }
 
 std::string MetaCore::Java::GetClassName(JNIEnv* env, jclass clazz) {
-    jstring string = RunMethod<jstring>(env, {clazz, clazz}, {"getName", "()Ljava/lang/String;"});
+    static JavaMethod<jstring()> getName("java/lang/Class", "getName");
+
+    jstring string = getName(env, clazz);
     std::string ret = ConvertString(env, string);
     env->DeleteLocalRef(string);
     return ret;
 }
 
 std::string MetaCore::Java::DescribeError(JNIEnv* env, jthrowable error) {
-    jobject stringWriter = NewObject(env, {"java/io/StringWriter"}, "()V");
-    jobject printWriter = NewObject(env, {"java/io/PrintWriter"}, "(Ljava/io/Writer;)V", stringWriter);
-    RunMethod(env, error, {"printStackTrace", "(Ljava/io/PrintWriter;)V"}, printWriter);
+    using PrintWriter = JavaObject<"java/io/PrintWriter">;
+    static JavaConstructor<> newStringWriter("java/io/StringWriter");
+    static JavaConstructor<JavaObject<"java/io/Writer">> newPrintWriter("java/io/PrintWriter");
+    static JavaMethod<void(PrintWriter)> printStackTrace("java/lang/Throwable", "printStackTrace");
+
+    jobject stringWriter = newStringWriter(env);
+    jobject printWriter = newPrintWriter(env, stringWriter);
+    printStackTrace(env, error, printWriter);
     std::string message = ToString(env, stringWriter);
     env->DeleteLocalRef(stringWriter);
     env->DeleteLocalRef(printWriter);
@@ -10,10 +10,16 @@
 static modloader::ModInfo modInfo = {MOD_ID, VERSION, 0};
 
 static void RegisterButtonEvents() {
-    for (int i = 0; i <= MetaCore::Input::ButtonsMax; i++) {
-        MetaCore::Events::RegisterEvent(MetaCore::Input::PressEvents, i);
-        MetaCore::Events::RegisterEvent(MetaCore::Input::ReleaseEvents, i);
-        MetaCore::Events::RegisterEvent(MetaCore::Input::HoldEvents, i);
+    using namespace MetaCore::Input;
+    for (auto controller : {Either, Left, Right}) {
+        for (int i = 0; i <= ButtonsMax; i++) {
+            int id = ButtonEvent(controller, (Buttons) i);
+            MetaCore::Events::RegisterEvent(PressEvents, id);
+            MetaCore::Events::RegisterEvent(ReleaseEvents, id);
+            MetaCore::Events::RegisterEvent(HoldEvents, id);
+            MetaCore::Events::RegisterEvent(DoubleTapEvents, id);
+            MetaCore::Events::RegisterEvent(LongPressEvents, id);
+        }
     }
 }
 
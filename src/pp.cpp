@@ -16,11 +16,9 @@
 using namespace GlobalNamespace;
 using namespace MetaCore;
 
-static CacheMap<std::string, std::pair<std::optional<PP::BLSongDiff>, std::optional<PP::SSSongDiff>>, 32> songCache;
+static CacheMap<std::string, PP::MapInfo, 32> songCache;
 
 struct Request {
-    using callback = std::function<void(std::optional<PP::BLSongDiff>, std::optional<PP::SSSongDiff>)>;
-
     std::string const key;
 
     std::optional<PP::BLSongDiff> blSong = std::nullopt;
@@ -28,14 +26,15 @@ struct Request {
     std::optional<PP::SSSongDiff> ssSong = std::nullopt;
     bool hasSs = false;
 
-    std::vector<callback> callbacks{};
+    // shared so that web threads can check for cancellation
+    std::shared_ptr<TaskGroup<PP::MapInfo>> tasks = std::make_shared<TaskGroup<PP::MapInfo>>();
 
     bool CheckDone() {
         if (!hasBl || !hasSs)
             return false;
-        for (auto& callback : callbacks)
-            callback(blSong, ssSong);
-        songCache.push(key, std::make_pair(std::move(blSong), std::move(ssSong)));
+        auto info = std::make_pair(std::move(blSong), std::move(ssSong));
+        songCache.push(key, info);
+        tasks->Complete(info);
         return true;
     }
 
@@ -57,6 +56,19 @@ struct Request {
 
 static std::map<std::string, Request> requests;
 
+// requests may have been dropped due to cancellation, in which case late results are ignored
+static void AddBl(std::string const& name, std::optional<PP::BLSongDiff> song) {
+    auto request = requests.find(name);
+    if (request != requests.end() && request->second.AddBl(std::move(song)))
+        requests.erase(request);
+}
+
+static void AddSs(std::string const& name, std::optional<PP::SSSongDiff> song) {
+    auto request = requests.find(name);
+    if (request != requests.end() && request->second.AddSs(std::move(song)))
+        requests.erase(request);
+}
+
 static constexpr double ScoresaberMult = 42.117208413;
 
 std::vector<std::pair<double, double>> const PP::BeatLeaderCurve = {
@@ -239,40 +251,53 @@ static void ProcessResponseBL(PP::BLSong song, BeatmapKey map) {
     for (auto const& diff : song.Difficulties) {
         if (diff.Characteristic == characteristic && diff.Difficulty == difficulty) {
             logger.debug("found correct difficulty, {:.2f} stars", diff.Stars);
-            if (requests[name].AddBl(std::move(diff)))
-                requests.erase(name);
+            AddBl(name, std::move(diff));
             return;
         }
     }
-    if (requests[name].AddBl(std::nullopt))
-        requests.erase(name);
+    AddBl(name, std::nullopt);
+}
+
+static void SetNoneBL(BeatmapKey map) {
+    AddBl(map.SerializedName(), std::nullopt);
 }
 
-static void GetMapInfoBL(BeatmapKey map, std::string hash) {
-    static auto const setNone = [](BeatmapKey map) mutable {
-        std::string name = map.SerializedName();
-        if (requests[name].AddBl(std::nullopt))
-            requests.erase(name);
-    };
+static void ParseResponseBL(std::string const& data, BeatmapKey map) {
+    logger.debug("got bl respose");
+    PP::BLSong song;
+    try {
+        ReadFromString(data, song);
+        MainThreadScheduler::Schedule([song = std::move(song), map]() { ProcessResponseBL(std::move(song), map); });
+    } catch (std::exception const& e) {
+        logger.error("failed to parse beatleader response: {}", e.what());
+        logger.debug("{}", data);
+        MainThreadScheduler::Schedule([map]() { SetNoneBL(map); });
+    }
+}
 
+static void GetMapInfoBL(BeatmapKey map, std::string hash, std::shared_ptr<TaskGroup<PP::MapInfo>> tasks) {
     std::string const url = "https://api.beatleader.xyz/map/hash/" + hash;
 
-    WebUtils::GetAsync<WebUtils::StringResponse>({url, std::string(MOD_ID " " VERSION)}, [map](WebUtils::StringResponse response) {
+    WebUtils::GetAsync<WebUtils::StringResponse>({url, std::string(MOD_ID " " VERSION)}, [map, tasks](WebUtils::StringResponse response) {
         if (!response.IsSuccessful() || !response.responseData) {
             logger.error("bl pp request failed {} {}", response.httpCode, response.curlStatus);
-            setNone(map);
+            MainThreadScheduler::Schedule([map]() { SetNoneBL(map); });
             return;
         }
-        logger.debug("got bl respose");
-        PP::BLSong song;
-        try {
-            ReadFromString(*response.responseData, song);
-            MainThreadScheduler::Schedule([song = std::move(song), map]() { ProcessResponseBL(std::move(song), map); });
-        } catch (std::exception const& e) {
-            logger.error("failed to parse beatleader response: {}", e.what());
-            logger.debug("{}", *response.responseData);
-            setNone(map);
+        if (!tasks->AnyActive()) {
+            MainThreadScheduler::Schedule([map, tasks, data = std::move(*response.responseData)]() {
+                auto request = requests.find(map.SerializedName());
+                if (request == requests.end())
+                    return;
+                // a new task could have been added while this was being scheduled, so keep the response for it
+                if (tasks->AnyActive())
+                    ParseResponseBL(data, map);
+                else
+                    requests.erase(request);
+            });
+            return;
         }
+        ParseResponseBL(*response.responseData, map);
     });
 }
 
@@ -286,6 +311,7 @@ static void GetSongDetails(auto&& callback) {
 
     logger.debug("initializing song details");
 
+    // blocks for the whole download and parse, so it would hold up a worker from the shared pool
     std::thread([callback]() mutable {
         songDetailsInstance = SongDetailsCache::SongDetails::Init().get();
         callback(songDetailsInstance);
@@ -299,8 +325,7 @@ static void GetMapInfoSS(BeatmapKey map, std::string hash) {
 
     GetSongDetails([name, hash, characteristic, difficulty](auto details) {
         auto const setNone = [&name]() {
-            if (requests[name].AddSs(std::nullopt))
-                requests.erase(name);
+            MainThreadScheduler::Schedule([name]() { AddSs(name, std::nullopt); });
         };
 
         logger.debug("got song details");
@@ -317,39 +342,39 @@ static void GetMapInfoSS(BeatmapKey map, std::string hash) {
         }
         logger.debug("found correct difficulty, {:.2f} stars", diff.starsSS);
 
-        MainThreadScheduler::Schedule([name, stars = diff.starsSS]() {
-            if (requests[name].AddSs(stars))
-                requests.erase(name);
-        });
+        MainThreadScheduler::Schedule([name, stars = diff.starsSS]() { AddSs(name, stars); });
     });
 }
 
-void PP::GetMapInfo(BeatmapKey map, std::function<void(std::optional<BLSongDiff>, std::optional<SSSongDiff>)> callback) {
-    if (!callback)
-        return;
+Task<PP::MapInfo> PP::GetMapInfo(BeatmapKey map, std::function<void(std::optional<BLSongDiff>, std::optional<SSSongDiff>)> callback) {
+    Task<MapInfo> ret;
+    if (callback)
+        ret.Then([callback = std::move(callback)](MapInfo const& info) { callback(info.first, info.second); });
 
     std::string const name = map.SerializedName();
     if (songCache.contains(name)) {
-        auto const& [bl, ss] = songCache[name];
-        callback(bl, ss);
-        return;
+        ret.Complete(songCache[name]);
+        return ret;
     }
     if (requests.contains(name)) {
-        requests[name].callbacks.emplace_back(std::move(callback));
-        return;
+        requests[name].tasks->Add(ret);
+        return ret;
     }
 
     std::string const id = map.levelId;
     std::string const hash = Songs::GetHash(id);
     if (hash.empty() || id.ends_with(" WIP")) {
-        callback(std::nullopt, std::nullopt);
-        return;
+        ret.Complete({std::nullopt, std::nullopt});
+        return ret;
     }
 
     logger.info("requesting PP info for {}", hash);
 
-    requests.emplace(name, name).first->second.callbacks.emplace_back(std::move(callback));
+    auto tasks = requests.emplace(name, name).first->second.tasks;
+    tasks->Add(ret);
 
-    GetMapInfoBL(map, hash);
+    GetMapInfoBL(map, hash, tasks);
     GetMapInfoSS(map, hash);
+
+    return ret;
 }
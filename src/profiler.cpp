@@ -0,0 +1,141 @@
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <fstream>
+#include <mutex>
+#include <vector>
+
+#include "main.hpp"
+#include "unity.hpp"
+
+std::atomic_bool MetaCore::Profiler::enabled = false;
+
+// histograms are only added once per hook, the first time it is called
+static std::mutex histogramsMutex;
+static std::vector<MetaCore::Profiler::Histogram*> histograms;
+
+static std::mutex fileMutex;
+static std::string dumpFile;
+
+static int GetBucket(uint64_t nanoseconds) {
+    if (nanoseconds < MetaCore::Profiler::BucketsPerOctave)
+        return nanoseconds;
+    // the octave and the next two bits after the leading one
+    int octave = std::bit_width(nanoseconds) - 1;
+    int sub = (nanoseconds >> (octave - 2)) & 3;
+    return std::min((octave - 1) * MetaCore::Profiler::BucketsPerOctave + sub, MetaCore::Profiler::BucketCount - 1);
+}
+
+// the middle of the range of durations in a bucket
+static double GetBucketValue(int bucket) {
+    if (bucket < MetaCore::Profiler::BucketsPerOctave)
+        return bucket;
+    int octave = bucket / MetaCore::Profiler::BucketsPerOctave + 1;
+    int sub = bucket % MetaCore::Profiler::BucketsPerOctave;
+    double width = std::ldexp(1, octave - 2);
+    return std::ldexp(1, octave) + (sub + 0.5) * width;
+}
+
+MetaCore::Profiler::Histogram::Histogram(char const* name) : name(name) {
+    std::unique_lock lock(histogramsMutex);
+    histograms.emplace_back(this);
+}
+
+void MetaCore::Profiler::Histogram::Record(uint64_t nanoseconds) {
+    buckets[GetBucket(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(nanoseconds, std::memory_order_relaxed);
+    uint64_t previous = max.load(std::memory_order_relaxed);
+    while (nanoseconds > previous && !max.compare_exchange_weak(previous, nanoseconds, std::memory_order_relaxed))
+        ;
+}
+
+static float GetPercentile(uint32_t const* counts, uint32_t calls, float percentile, uint64_t max) {
+    uint32_t target = std::max<uint32_t>(std::ceil(calls * percentile), 1);
+    uint32_t seen = 0;
+    for (int i = 0; i < MetaCore::Profiler::BucketCount; i++) {
+        seen += counts[i];
+        if (seen >= target)
+            return std::min<double>(GetBucketValue(i), max) / 1e6;
+    }
+    return max / 1e6;
+}
+
+template <class T>
+static T Read(std::atomic<T>& value, bool reset) {
+    return reset ? value.exchange(0, std::memory_order_relaxed) : value.load(std::memory_order_relaxed);
+}
+
+// a snapshot of each histogram, which can be slightly inconsistent if a hook is running on another thread
+static std::vector<MetaCore::Engine::HookTiming> GetTimings(bool reset) {
+    std::vector<MetaCore::Engine::HookTiming> ret;
+    std::unique_lock lock(histogramsMutex);
+
+    for (auto histogram : histograms) {
+        uint32_t counts[MetaCore::Profiler::BucketCount];
+        uint32_t calls = 0;
+        for (int i = 0; i < MetaCore::Profiler::BucketCount; i++) {
+            counts[i] = Read(histogram->buckets[i], reset);
+            calls += counts[i];
+        }
+        uint64_t total = Read(histogram->total, reset);
+        uint64_t max = Read(histogram->max, reset);
+        if (calls == 0)
+            continue;
+
+        ret.emplace_back(
+            histogram->name,
+            (int) calls,
+            GetPercentile(counts, calls, 0.5, max),
+            GetPercentile(counts, calls, 0.99, max),
+            max / 1e6f,
+            total / 1e6f
+        );
+    }
+    std::sort(ret.begin(), ret.end(), [](auto const& a, auto const& b) { return a.totalMilliseconds > b.totalMilliseconds; });
+    return ret;
+}
+
+void MetaCore::Profiler::Dump() {
+    if (!enabled)
+        return;
+
+    auto timings = GetTimings(true);
+    std::string report = fmt::format("hook timings for {} hooks:\n", timings.size());
+    for (auto const& timing : timings) {
+        report += fmt::format(
+            "{}: {} calls, p50 {:.4f} ms, p99 {:.4f} ms, max {:.4f} ms, total {:.2f} ms\n",
+            timing.name,
+            timing.calls,
+            timing.medianMilliseconds,
+            timing.p99Milliseconds,
+            timing.maxMilliseconds,
+            timing.totalMilliseconds
+        );
+    }
+    logger.info("{}", report);
+
+    std::unique_lock lock(fileMutex);
+    if (dumpFile.empty())
+        return;
+    std::ofstream stream(dumpFile, std::ios::app);
+    if (stream)
+        stream << report << "\n";
+    else
+        logger.error("failed to write hook timings to {}", dumpFile);
+}
+
+void MetaCore::Engine::SetHookProfiling(bool enabled, std::string file) {
+    std::unique_lock lock(fileMutex);
+    dumpFile = std::move(file);
+    lock.unlock();
+    // start fresh so that a previous session's timings aren't mixed in
+    if (enabled && !Profiler::enabled)
+        GetTimings(true);
+    Profiler::enabled = enabled;
+}
+
+std::vector<MetaCore::Engine::HookTiming> MetaCore::Engine::GetHookTimings() {
+    return GetTimings(false);
+}
@@ -3,6 +3,7 @@
 #include "GlobalNamespace/BeatmapCharacteristicSO.hpp"
 #include "GlobalNamespace/BeatmapDataLoader.hpp"
 #include "GlobalNamespace/BeatmapLevelsModel.hpp"
+#include "GlobalNamespace/BeatmapLevelsRepository.hpp"
 #include "GlobalNamespace/IPreviewMediaData.hpp"
 #include "GlobalNamespace/LevelCollectionNavigationController.hpp"
 #include "GlobalNamespace/LevelCollectionViewController.hpp"
@@ -13,25 +14,45 @@
 #include "System/Threading/Tasks/Task.hpp"
 #include "System/Threading/Tasks/Task_1.hpp"
 #include "game.hpp"
+#include "il2cpp.hpp"
 #include "internals.hpp"
 #include "main.hpp"
 #include "types.hpp"
 
 using namespace GlobalNamespace;
 
-std::string MetaCore::Songs::GetHash(std::string levelId) {
-    auto prefixIndex = levelId.find("custom_level_");
-    if (prefixIndex == std::string::npos)
-        return "";
+std::string MetaCore::Songs::Hash::ToString() const {
+    static constexpr char digits[] = "0123456789ABCDEF";
+    std::string ret(bytes.size() * 2, '0');
+    for (size_t i = 0; i < bytes.size(); i++) {
+        ret[i * 2] = digits[bytes[i] >> 4];
+        ret[i * 2 + 1] = digits[bytes[i] & 0xf];
+    }
+    return ret;
+}
+
+std::string_view MetaCore::Songs::GetHashView(std::string_view levelId) {
+    static constexpr std::string_view prefix = "custom_level_";
+    auto prefixIndex = levelId.find(prefix);
+    if (prefixIndex == std::string_view::npos)
+        return {};
     // remove prefix
-    levelId = levelId.substr(prefixIndex + 13);
+    levelId.remove_prefix(prefixIndex + prefix.size());
     auto wipIndex = levelId.find(" WIP");
-    if (wipIndex != std::string::npos)
+    if (wipIndex != std::string_view::npos)
         levelId = levelId.substr(0, wipIndex);
     // make lowercase?
     return levelId;
 }
 
+std::optional<MetaCore::Songs::Hash> MetaCore::Songs::GetBinaryHash(std::string_view levelId) {
+    return Hash::Parse(GetHashView(levelId));
+}
+
+std::string MetaCore::Songs::GetHash(std::string levelId) {
+    return std::string(GetHashView(levelId));
+}
+
 std::string MetaCore::Songs::GetHash(BeatmapKey beatmap) {
     return GetHash(beatmap.levelId);
 }
@@ -40,27 +61,35 @@ std::string MetaCore::Songs::GetHash(BeatmapLevel* beatmap) {
     return GetHash(beatmap->levelID);
 }
 
-static std::map<std::string, std::vector<std::function<void(IReadonlyBeatmapData*)>>> dataRequests;
+static std::map<std::string, std::shared_ptr<MetaCore::TaskGroup<IReadonlyBeatmapData*>>> dataRequests;
 
-void MetaCore::Songs::GetBeatmapData(BeatmapKey beatmap, std::function<void(IReadonlyBeatmapData*)> callback) {
+MetaCore::Task<IReadonlyBeatmapData*> MetaCore::Songs::GetBeatmapData(BeatmapKey beatmap, std::function<void(IReadonlyBeatmapData*)> callback) {
     logger.debug("loading beatmap data for {} {} {}", beatmap.levelId, beatmap.beatmapCharacteristic->_serializedName, (int) beatmap.difficulty);
 
+    Task<IReadonlyBeatmapData*> ret;
+    if (callback)
+        ret.Then(std::move(callback));
+
     std::string name = beatmap.SerializedName();
     if (dataRequests.contains(name)) {
-        dataRequests[name].emplace_back(std::move(callback));
-        return;
+        dataRequests[name]->Add(ret);
+        return ret;
     }
-    dataRequests.emplace(name, std::vector({std::move(callback)}));
+    auto tasks = dataRequests.emplace(name, std::make_shared<TaskGroup<IReadonlyBeatmapData*>>()).first->second;
+    tasks->Add(ret);
 
     // I have no idea what BeatmapLevelDataVersion is for
     auto levelDataTask =
         Game::GetMenuTransitionsHelper()->_beatmapLevelsModel->LoadBeatmapLevelDataAsync(beatmap.levelId, BeatmapLevelDataVersion::Original, nullptr);
 
-    MainThreadScheduler::Await(levelDataTask, [beatmap, name, levelDataTask]() {
+    MainThreadScheduler::Await(levelDataTask, [beatmap, name, levelDataTask, tasks]() {
         if (levelDataTask->ResultOnSuccess.isError) {
             logger.warn("failed to load beatmap data");
-            for (auto& callback : dataRequests[name])
-                callback(nullptr);
+            dataRequests.erase(name);
+            tasks->Complete(nullptr);
+        } else if (!tasks->AnyActive()) {
+            // skip the actual parsing if nothing wants it anymore
+            logger.debug("beatmap data requests cancelled");
             dataRequests.erase(name);
         } else {
             logger.debug("got beatmap level data");
@@ -76,23 +105,72 @@ void MetaCore::Songs::GetBeatmapData(BeatmapKey beatmap, std::function<void(IRea
                 nullptr,
                 true
             );
-            MainThreadScheduler::Await(beatmapDataTask, [beatmapDataTask, name]() {
-                for (auto& callback : dataRequests[name])
-                    callback(beatmapDataTask->ResultOnSuccess);
+            MainThreadScheduler::Await(beatmapDataTask, [beatmapDataTask, name, tasks]() {
                 dataRequests.erase(name);
+                tasks->Complete(beatmapDataTask->ResultOnSuccess);
             });
         }
     });
+
+    return ret;
 }
 
-void MetaCore::Songs::GetSongCover(BeatmapLevel* beatmap, std::function<void(UnityEngine::Sprite*)> callback) {
+MetaCore::Task<UnityEngine::Sprite*> MetaCore::Songs::GetSongCover(BeatmapLevel* beatmap, std::function<void(UnityEngine::Sprite*)> callback) {
+    Task<UnityEngine::Sprite*> ret;
+    if (callback)
+        ret.Then(std::move(callback));
     auto task = beatmap->previewMediaData->GetCoverSpriteAsync();
-    MainThreadScheduler::Await(task, [task, callback = std::move(callback)]() { callback(task->ResultOnSuccess); });
+    MainThreadScheduler::Await(task, [task, ret]() { ret.Complete(task->ResultOnSuccess); });
+    return ret;
+}
+
+struct StringHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view string) const noexcept { return std::hash<std::string_view>()(string); }
+};
+
+static bool levelsIndexed = false;
+static std::unordered_map<std::string, BeatmapLevel*, StringHash, std::equal_to<>> levelsById;
+static std::unordered_map<MetaCore::Songs::Hash, BeatmapLevel*> levelsByHash;
+
+static void AddIndexedLevel(std::string levelId, BeatmapLevel* level) {
+    if (auto hash = MetaCore::Songs::GetBinaryHash(levelId))
+        levelsByHash.emplace(*hash, level);
+    levelsById.emplace(std::move(levelId), level);
+}
+
+static BeatmapLevelsModel* GetLevelsModel() {
+    auto container = MetaCore::Game::GetAppDiContainer();
+    return container ? container->Resolve<BeatmapLevelsModel*>() : nullptr;
+}
+
+static void IndexLevels() {
+    if (levelsIndexed)
+        return;
+    auto model = GetLevelsModel();
+    if (!model || !model->_allLoadedBeatmapLevelsRepository)
+        return;
+    for (auto [levelId, level] : DictionaryW<StringW, BeatmapLevel*>(model->_allLoadedBeatmapLevelsRepository->_idToBeatmapLevel)) {
+        if (level)
+            AddIndexedLevel(levelId, level);
+    }
+    logger.debug("indexed {} levels", levelsById.size());
+    levelsIndexed = true;
 }
 
-// avoid back and forth string -> StringW conversions
-static BeatmapLevel* FindLevelInternal(StringW levelId) {
-    return MetaCore::Game::GetAppDiContainer()->Resolve<BeatmapLevelsModel*>()->GetBeatmapLevel(levelId);
+static BeatmapLevel* FindLevelInternal(std::string_view levelId) {
+    IndexLevels();
+    auto found = levelsById.find(levelId);
+    if (found != levelsById.end())
+        return found->second;
+    // levels not in the loaded repository (such as unowned DLC) may still be found by the model
+    auto model = GetLevelsModel();
+    if (!model)
+        return nullptr;
+    auto level = model->GetBeatmapLevel(std::string(levelId));
+    if (level && levelsIndexed)
+        AddIndexedLevel(std::string(levelId), level);
+    return level;
 }
 
 BeatmapLevel* MetaCore::Songs::FindLevel(std::string levelId) {
@@ -100,7 +178,29 @@ BeatmapLevel* MetaCore::Songs::FindLevel(std::string levelId) {
 }
 
 BeatmapLevel* MetaCore::Songs::FindLevel(BeatmapKey beatmap) {
-    return FindLevelInternal(beatmap.levelId);
+    return FindLevelInternal((std::string) beatmap.levelId);
+}
+
+BeatmapLevel* MetaCore::Songs::FindLevel(Hash hash) {
+    IndexLevels();
+    auto found = levelsByHash.find(hash);
+    if (found != levelsByHash.end())
+        return found->second;
+    return FindLevelInternal("custom_level_" + hash.ToString());
+}
+
+std::vector<BeatmapLevel*> MetaCore::Songs::FindLevels(std::span<std::string_view const> levelIds) {
+    std::vector<BeatmapLevel*> ret;
+    ret.reserve(levelIds.size());
+    for (auto levelId : levelIds)
+        ret.emplace_back(FindLevelInternal(levelId));
+    return ret;
+}
+
+void MetaCore::Songs::RefreshLevelIndex() {
+    levelsIndexed = false;
+    levelsById.clear();
+    levelsByHash.clear();
 }
 
 BeatmapKey MetaCore::Songs::GetSelectedKey(bool last) {
@@ -1,37 +1,106 @@
 #include "strings.hpp"
 
+#include <algorithm>
+#include <array>
 #include <filesystem>
+#include <limits>
+#include <vector>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// just whitelist simple characters, replacing everything else with an underscore
+static constexpr auto SanitizeTable = [] {
+    std::array<char, 256> ret;
+    for (int c = 0; c < 256; c++) {
+        bool ok = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+        ok = ok || c == '_' || c == '-' || c == '.' || c == '/' || c == '(' || c == ')';
+        ret[c] = ok ? c : '_';
+    }
+    return ret;
+}();
+
+#if defined(__ARM_NEON)
+static uint8x16_t InRange(uint8x16_t chars, uint8_t first, uint8_t last) {
+    return vcleq_u8(vsubq_u8(chars, vdupq_n_u8(first)), vdupq_n_u8(last - first));
+}
+
+// the same whitelist as the table, sixteen characters at a time
+static uint8x16_t Sanitize(uint8x16_t chars) {
+    uint8x16_t ok = vorrq_u8(vorrq_u8(InRange(chars, 'a', 'z'), InRange(chars, 'A', 'Z')), InRange(chars, '0', '9'));
+    // '-', '.', and '/' are contiguous, as are '(' and ')'
+    ok = vorrq_u8(ok, vorrq_u8(InRange(chars, '-', '/'), InRange(chars, '(', ')')));
+    ok = vorrq_u8(ok, vceqq_u8(chars, vdupq_n_u8('_')));
+    return vbslq_u8(ok, chars, vdupq_n_u8('_'));
+}
+#endif
 
 std::string MetaCore::Strings::SanitizedPath(std::string const& path) {
-    std::string newName;
-    newName.reserve(path.size());
-    // just whitelist simple characters
-    static auto const okChar = [](unsigned char c) {
-        if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9'))
-            return true;
-        if (c == '_' || c == '-' || c == '.' || c == '/' || c == '(' || c == ')')
-            return true;
-        return false;
-    };
-    std::transform(path.begin(), path.end(), std::back_inserter(newName), [](unsigned char c) {
-        if (!okChar(c))
-            return (unsigned char) ('_');
-        return c;
-    });
-    if (newName == "")
+    if (path.empty())
         return "_";
+    std::string newName(path.size(), '_');
+    auto input = (uint8_t const*) path.data();
+    auto output = (uint8_t*) newName.data();
+    size_t i = 0;
+#if defined(__ARM_NEON)
+    for (; i + 16 <= path.size(); i += 16)
+        vst1q_u8(output + i, Sanitize(vld1q_u8(input + i)));
+#endif
+    for (; i < path.size(); i++)
+        output[i] = SanitizeTable[input[i]];
     return newName;
 }
 
+// gets the number from a name in the form stem_number.extension, or 0 if it isn't one
+static int GetSuffixNumber(std::string_view name, std::string_view stem, std::string_view extension) {
+    if (name.size() <= stem.size() + extension.size() + 1 || !name.starts_with(stem) || !name.ends_with(extension))
+        return 0;
+    name = name.substr(stem.size(), name.size() - stem.size() - extension.size());
+    // only exactly what UniqueFileName would have created, so no leading zeros
+    if (name[0] != '_' || name[1] == '0')
+        return 0;
+    int ret = 0;
+    for (char c : name.substr(1)) {
+        if (c < '0' || c > '9' || ret > (std::numeric_limits<int>::max() - 9) / 10)
+            return 0;
+        ret = ret * 10 + (c - '0');
+    }
+    return ret;
+}
+
 std::string MetaCore::Strings::UniqueFileName(std::string const& file, std::string const& directory) {
     std::filesystem::path input = file;
     std::filesystem::path dir = directory;
     std::string stem = input.stem();
     std::string extension = input.extension();
     std::string output = stem + extension;
+    if (!std::filesystem::exists(dir / output))
+        return output;
+
+    // list the directory once instead of checking each numbered name, ignoring case since /sdcard does as well
+    std::string lowerStem = Lower(stem);
+    std::string lowerExtension = Lower(extension);
+    std::vector<int> numbers;
+    std::error_code error;
+    for (std::filesystem::directory_iterator entry(dir, error), end; !error && entry != end; entry.increment(error)) {
+        if (int number = GetSuffixNumber(Lower(entry->path().filename()), lowerStem, lowerExtension))
+            numbers.emplace_back(number);
+    }
+
+    // the lowest free number, as the names are not always added in order
+    std::sort(numbers.begin(), numbers.end());
     int num = 1;
+    for (int number : numbers) {
+        if (number == num)
+            num++;
+        else if (number > num)
+            break;
+    }
+    // still confirm with the filesystem, in case the listing failed or it compares names differently
+    output = fmt::format("{}_{}{}", stem, num, extension);
     while (std::filesystem::exists(dir / output))
-        output = fmt::format("{}_{}{}", stem, num++, extension);
+        output = fmt::format("{}_{}{}", stem, ++num, extension);
     return output;
 }
 
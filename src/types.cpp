@@ -1,5 +1,14 @@
 #include "types.hpp"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <unordered_map>
+
+#include "main.hpp"
+
 DEFINE_TYPE(MetaCore, ObjectSignal);
 DEFINE_TYPE(MetaCore, EndDragHandler);
 DEFINE_TYPE(MetaCore, KeyboardCloseHandler);
@@ -17,62 +26,253 @@ void MetaCore::ObjectSignal::OnDisable() {
         onDisable();
 }
 
+void MetaCore::ObjectSignal::OnTransformChildrenChanged() {
+    if (onChildrenChanged)
+        onChildrenChanged();
+}
+
 void MetaCore::EndDragHandler::OnPointerUp(UnityEngine::EventSystems::PointerEventData* eventData) {
     if (callback)
         callback();
 }
 
-static std::mutex callbacksMutex;
-static std::queue<std::function<void()>> callbacks;
+struct ScheduledCallback {
+    std::function<void()> callback;
+    ScheduledCallback* next;
+};
+
+using Clock = std::chrono::steady_clock;
+
+static constexpr int PriorityCount = (int) MetaCore::Engine::Priority::Background + 1;
+
+// lock free stacks, reversed on the main thread to run in order
+static std::array<std::atomic<ScheduledCallback*>, PriorityCount> callbacks = {};
+// callbacks taken from the stacks but not yet run, main thread only
+static std::array<std::deque<std::function<void()>>, PriorityCount> pending;
+static std::atomic<float> budget = 0;
+static std::optional<Clock::time_point> deferredSince;
+static int deferredFrames = 0;
 static std::mutex waitersMutex;
+static std::atomic_int waitersCount = 0;
 static std::vector<std::pair<std::function<bool()>, std::function<void()>>> waiters;
+struct ScheduledUpdate {
+    int id;
+    std::function<void()> callback;
+    int frames;
+    Clock::duration period;
+    int framesLeft = 0;
+    Clock::time_point nextTime = {};
+    std::atomic_bool removed = false;
+    // only accessed on the main thread
+    int calls = 0;
+    Clock::duration totalTime = {};
+    Clock::duration maxTime = {};
+};
+
 static std::mutex updatesMutex;
-static std::vector<std::function<void()>> updates;
+static int nextUpdateId = 0;
+static std::unordered_map<int, std::shared_ptr<ScheduledUpdate>> updatesById;
+static std::vector<std::shared_ptr<ScheduledUpdate>> addedUpdates;
+static std::atomic_bool hasAddedUpdates = false;
+// main thread only, avoids copying or locking every frame
+static std::vector<std::shared_ptr<ScheduledUpdate>> updates;
+static std::atomic_bool timeUpdates = false;
 
-void MetaCore::MainThreadScheduler::Update() {
-    std::unique_lock waitersLock(waitersMutex);
-    std::unique_lock callbacksLock(callbacksMutex);
-    std::unique_lock updatesLock(updatesMutex);
+static void RunWaiters() {
+    // avoid locking entirely in the common case of nothing waiting
+    if (waitersCount.load(std::memory_order_relaxed) == 0)
+        return;
 
+    std::unique_lock lock(waitersMutex);
     decltype(waiters) waitersCopy;
     waitersCopy.swap(waiters);
+    lock.unlock();
 
-    for (auto& [until, callback] : waitersCopy) {
-        if (until())
-            callbacks.emplace(std::move(callback));
+    std::vector<std::function<void()>> ready;
+    decltype(waiters) waiting;
+    for (auto& waiter : waitersCopy) {
+        if (waiter.first())
+            ready.emplace_back(std::move(waiter.second));
         else
-            waiters.emplace_back(std::move(until), std::move(callback));
+            waiting.emplace_back(std::move(waiter));
+    }
+
+    lock.lock();
+    // waiters could have been added while evaluating
+    waiters.insert(waiters.begin(), std::make_move_iterator(waiting.begin()), std::make_move_iterator(waiting.end()));
+    waitersCount -= ready.size();
+    lock.unlock();
+
+    for (auto& callback : ready)
+        callback();
+}
+
+static void TakeCallbacks(int priority) {
+    auto head = callbacks[priority].exchange(nullptr, std::memory_order_acquire);
+    if (!head)
+        return;
+
+    ScheduledCallback* ordered = nullptr;
+    while (head) {
+        auto next = head->next;
+        head->next = ordered;
+        ordered = head;
+        head = next;
     }
 
-    decltype(callbacks) callbacksCopy;
-    callbacksCopy.swap(callbacks);
+    while (ordered) {
+        std::unique_ptr<ScheduledCallback> current(ordered);
+        ordered = current->next;
+        pending[priority].emplace_back(std::move(current->callback));
+    }
+}
 
-    decltype(updates) updatesCopy = {updates.begin(), updates.end()};
+static void RunCallbacks() {
+    auto start = Clock::now();
+    float budgetMs = budget.load(std::memory_order_relaxed);
+    auto deadline = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float, std::milli>(budgetMs));
 
-    waitersLock.unlock();
-    callbacksLock.unlock();
-    updatesLock.unlock();
+    for (int priority = 0; priority < PriorityCount; priority++) {
+        TakeCallbacks(priority);
+        bool budgeted = budgetMs > 0 && priority != (int) MetaCore::Engine::Priority::Gameplay;
+        auto& queue = pending[priority];
+        int ran = 0;
+        while (!queue.empty()) {
+            // always run at least one callback of each priority so that none can be starved by the others
+            if (budgeted && ran > 0 && Clock::now() >= deadline)
+                break;
+            auto callback = std::move(queue.front());
+            queue.pop_front();
+            callback();
+            if (budgeted)
+                ran++;
+        }
+    }
 
-    while (!callbacksCopy.empty()) {
-        callbacksCopy.front()();
-        callbacksCopy.pop();
+    bool deferred = std::any_of(pending.begin(), pending.end(), [](auto const& queue) { return !queue.empty(); });
+    if (deferred) {
+        if (!deferredSince)
+            deferredSince = start;
+        deferredFrames++;
+    } else if (deferredSince) {
+        float milliseconds = std::chrono::duration<float, std::milli>(Clock::now() - *deferredSince).count();
+        logger.debug("main thread callbacks were deferred for {} frames ({:.1f}ms)", deferredFrames, milliseconds);
+        deferredSince = std::nullopt;
+        deferredFrames = 0;
     }
+}
 
-    for (auto& callback : updatesCopy)
-        callback();
+static void RunUpdates() {
+    if (hasAddedUpdates.exchange(false)) {
+        std::unique_lock lock(updatesMutex);
+        updates.insert(updates.end(), std::make_move_iterator(addedUpdates.begin()), std::make_move_iterator(addedUpdates.end()));
+        addedUpdates.clear();
+    }
+
+    bool timing = timeUpdates.load(std::memory_order_relaxed);
+    auto now = Clock::now();
+    bool anyRemoved = false;
+    // updates added during this loop will only be run next frame
+    for (size_t i = 0, size = updates.size(); i < size; i++) {
+        auto& update = *updates[i];
+        if (update.removed) {
+            anyRemoved = true;
+            continue;
+        }
+        if (update.frames > 1) {
+            if (update.framesLeft-- > 0)
+                continue;
+            update.framesLeft = update.frames - 1;
+        }
+        if (update.period.count() > 0) {
+            if (now < update.nextTime)
+                continue;
+            // don't try to catch up after a long frame
+            update.nextTime = std::max(update.nextTime + update.period, now);
+        }
+        if (!timing) {
+            update.callback();
+            continue;
+        }
+        auto start = Clock::now();
+        update.callback();
+        auto time = Clock::now() - start;
+        update.calls++;
+        update.totalTime += time;
+        update.maxTime = std::max(update.maxTime, time);
+    }
+
+    if (anyRemoved)
+        std::erase_if(updates, [](auto const& update) { return update->removed.load(); });
 }
 
-void MetaCore::MainThreadScheduler::Schedule(std::function<void()> callback) {
-    std::unique_lock lock(callbacksMutex);
-    callbacks.emplace(std::move(callback));
+void MetaCore::MainThreadScheduler::Update() {
+    RunWaiters();
+    RunCallbacks();
+
+    RunUpdates();
+}
+
+void MetaCore::MainThreadScheduler::Schedule(std::function<void()> callback, MetaCore::Engine::Priority priority) {
+    auto& stack = callbacks[std::clamp((int) priority, 0, PriorityCount - 1)];
+    auto scheduled = new ScheduledCallback{std::move(callback), stack.load(std::memory_order_relaxed)};
+    while (!stack.compare_exchange_weak(scheduled->next, scheduled, std::memory_order_release, std::memory_order_relaxed))
+        continue;
 }
 
 void MetaCore::MainThreadScheduler::Schedule(std::function<bool()> wait, std::function<void()> callback) {
     std::unique_lock lock(waitersMutex);
     waiters.emplace_back(std::move(wait), std::move(callback));
+    waitersCount++;
+}
+
+int MetaCore::MainThreadScheduler::AddUpdate(std::function<void()> callback, int frames, float seconds) {
+    auto update = std::make_shared<ScheduledUpdate>();
+    update->callback = std::move(callback);
+    update->frames = std::max(frames, 1);
+    update->period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(std::max(seconds, 0.f)));
+
+    std::unique_lock lock(updatesMutex);
+    update->id = nextUpdateId++;
+    updatesById.emplace(update->id, update);
+    addedUpdates.emplace_back(update);
+    hasAddedUpdates = true;
+    return update->id;
 }
 
-void MetaCore::MainThreadScheduler::AddUpdate(std::function<void()> callback) {
+void MetaCore::MainThreadScheduler::RemoveUpdate(int id) {
     std::unique_lock lock(updatesMutex);
-    updates.emplace_back(std::move(callback));
+    auto update = updatesById.find(id);
+    if (update == updatesById.end())
+        return;
+    update->second->removed = true;
+    updatesById.erase(update);
+}
+
+void MetaCore::MainThreadScheduler::SetUpdateTiming(bool enabled) {
+    timeUpdates = enabled;
+}
+
+std::vector<MetaCore::Engine::UpdateTiming> MetaCore::MainThreadScheduler::GetUpdateTimings() {
+    using Milliseconds = std::chrono::duration<float, std::milli>;
+
+    std::vector<Engine::UpdateTiming> ret;
+    for (auto const& update : updates) {
+        if (update->calls == 0 || update->removed)
+            continue;
+        float average = Milliseconds(update->totalTime).count() / update->calls;
+        ret.emplace_back(update->id, update->calls, average, Milliseconds(update->maxTime).count());
+    }
+    std::sort(ret.begin(), ret.end(), [](auto const& a, auto const& b) { return a.averageMilliseconds > b.averageMilliseconds; });
+    return ret;
+}
+
+void MetaCore::MainThreadScheduler::SetBudget(float milliseconds) {
+    budget = std::max(milliseconds, 0.f);
+}
+
+float MetaCore::MainThreadScheduler::GetDeferral() {
+    if (!deferredSince)
+        return 0;
+    return std::chrono::duration<float, std::milli>(Clock::now() - *deferredSince).count();
 }
@@ -1,15 +1,40 @@
 #include "unity.hpp"
 
+#include <pthread.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "Unity/Collections/NativeArray_1.hpp"
 #include "UnityEngine/Color.hpp"
+#include "UnityEngine/Color32.hpp"
 #include "UnityEngine/Graphics.hpp"
-#include "UnityEngine/ImageConversion.hpp"
+#include "UnityEngine/Object.hpp"
 #include "UnityEngine/Rect.hpp"
 #include "UnityEngine/RenderTexture.hpp"
 #include "UnityEngine/RenderTextureFormat.hpp"
 #include "UnityEngine/RenderTextureReadWrite.hpp"
+#include "UnityEngine/Rendering/AsyncGPUReadback.hpp"
+#include "UnityEngine/Rendering/AsyncGPUReadbackRequest.hpp"
+#include "UnityEngine/SystemInfo.hpp"
 #include "UnityEngine/TextureFormat.hpp"
+#include "UnityEngine/Time.hpp"
 #include "beatsaber-hook/shared/utils/il2cpp-utils.hpp"
+#include "delegates.hpp"
+#include "image.hpp"
+#include "java.hpp"
 #include "main.hpp"
+#include "maps.hpp"
 #include "operators.hpp"
 #include "types.hpp"
 
@@ -24,52 +49,180 @@ Vector3 MetaCore::Engine::GetClampedEuler(Quaternion rotation) {
     return ret;
 }
 
-static void DisableAllButImpl(Transform* original, Transform* source, std::set<std::string> enabled, std::set<std::string> disabled) {
-    for (int i = 0; i < source->GetChildCount(); i++) {
+namespace {
+    struct StringHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view string) const noexcept { return std::hash<std::string_view>()(string); }
+    };
+
+    using NameSet = std::unordered_set<std::string_view, StringHash, std::equal_to<>>;
+}
+
+// finds the final state of each object without changing anything yet, returning if any of the children should be active
+static bool GetActiveStates(Transform* source, NameSet const& enabled, NameSet const& disabled, std::vector<std::pair<GameObject*, bool>>& states) {
+    bool anyActive = false;
+    int count = source->GetChildCount();
+    for (int i = 0; i < count; i++) {
         auto child = source->GetChild(i).unsafePtr();
         std::string name = child->name;
-        if (enabled.contains(name)) {
-            auto loopback = child;
-            while (loopback != original) {
-                loopback->gameObject->active = true;
-                loopback = loopback->parent;
-            }
-        } else {
-            child->gameObject->active = false;
-            if (!disabled.contains(name))
-                DisableAllButImpl(original, child, enabled, disabled);
-        }
+        bool active;
+        if (enabled.contains(name))
+            active = true;
+        else if (disabled.contains(name))
+            active = false;
+        else
+            active = GetActiveStates(child, enabled, disabled, states);
+        states.emplace_back(child->gameObject, active);
+        anyActive |= active;
     }
+    return anyActive;
 }
 
 void MetaCore::Engine::DisableAllBut(TransformWrapper parent, std::set<std::string> enabled, std::set<std::string> disabled) {
-    if (!enabled.contains(parent->name))
-        DisableAllButImpl(parent, parent, enabled, disabled);
+    if (enabled.contains(parent->name))
+        return;
+
+    NameSet enabledNames(enabled.begin(), enabled.end());
+    NameSet disabledNames(disabled.begin(), disabled.end());
+    std::vector<std::pair<GameObject*, bool>> states;
+    GetActiveStates(parent, enabledNames, disabledNames, states);
+
+    // every object is changed at most once, and only if needed
+    for (auto& [object, active] : states) {
+        if (object->activeSelf != active)
+            object->SetActive(active);
+    }
 }
 
-Transform* MetaCore::Engine::FindRecursive(TransformWrapper parent, std::string name) {
-    for (int i = 0; i < parent->GetChildCount(); i++) {
-        auto child = parent->GetChild(i);
-        if (child->name == name)
-            return child;
-    }
-    // breadth first
-    for (int i = 0; i < parent->GetChildCount(); i++) {
-        if (auto ret = FindRecursive(parent->GetChild(i), name))
+namespace {
+    // a snapshot of a hierarchy, with the objects for each name in the order the search would find them
+    struct HierarchyIndex {
+        struct Node {
+            UnityW<Transform> transform;
+            int parent;
+            std::string name;
+        };
+
+        std::vector<Node> nodes;
+        std::unordered_map<Transform*, int> indices;
+        std::unordered_map<std::string, std::vector<int>, StringHash, std::equal_to<>> names;
+        int frame;
+    };
+}
+
+static MetaCore::CacheMap<int, std::shared_ptr<HierarchyIndex>, 16> hierarchyIndices;
+
+// direct children first, then the children of each child
+static void IndexChildren(HierarchyIndex& index, int parent) {
+    auto transform = index.nodes[parent].transform.unsafePtr();
+    int first = index.nodes.size();
+    int count = transform->GetChildCount();
+    for (int i = 0; i < count; i++) {
+        auto child = transform->GetChild(i).unsafePtr();
+        int node = index.nodes.size();
+        auto& added = index.nodes.emplace_back(child, parent, child->name);
+        index.indices.emplace(child, node);
+        index.names[added.name].emplace_back(node);
+    }
+    for (int i = first; i < first + count; i++)
+        IndexChildren(index, i);
+}
+
+static void InvalidateIndex(int id) {
+    if (hierarchyIndices.contains(id))
+        hierarchyIndices.at(id) = nullptr;
+}
+
+static std::shared_ptr<HierarchyIndex> BuildIndex(Transform* parent) {
+    int id = parent->GetInstanceID();
+    auto ret = std::make_shared<HierarchyIndex>();
+    ret->frame = Time::get_frameCount();
+    ret->nodes.emplace_back(parent, -1, "");
+    ret->indices.emplace(parent, 0);
+    IndexChildren(*ret, 0);
+
+    // only catches direct children changing, so deeper changes are found by validating on use
+    MetaCore::Engine::GetOrAddComponent<MetaCore::ObjectSignal*>(parent)->onChildrenChanged = [id]() { InvalidateIndex(id); };
+    hierarchyIndices.push(id, ret);
+    return ret;
+}
+
+static std::shared_ptr<HierarchyIndex> GetIndex(Transform* parent) {
+    int id = parent->GetInstanceID();
+    if (hierarchyIndices.contains(id)) {
+        if (auto ret = hierarchyIndices.at(id))
             return ret;
     }
-    return nullptr;
+    return BuildIndex(parent);
 }
 
-std::string MetaCore::Engine::GetTransformPath(TransformWrapper parent, TransformWrapper child) {
+// returns false if the snapshot was found to be out of date
+static bool FindInIndex(HierarchyIndex const& index, Transform* parent, std::string_view name, Transform*& result) {
+    result = nullptr;
+    auto found = index.names.find(name);
+    if (found == index.names.end())
+        return true;
+    auto& transform = index.nodes[found->second.front()].transform;
+    // renamed objects would still be found by their old names
+    if (!transform || !transform->IsChildOf(parent) || transform->name != std::string(name))
+        return false;
+    result = transform;
+    return true;
+}
+
+void MetaCore::Engine::InvalidateHierarchy(TransformWrapper parent) {
+    InvalidateIndex(parent->GetInstanceID());
+}
+
+Transform* MetaCore::Engine::FindRecursive(TransformWrapper parent, std::string name) {
+    auto index = GetIndex(parent);
+    Transform* ret;
+    if (FindInIndex(*index, parent, name, ret) && (ret || index->frame == Time::get_frameCount()))
+        return ret;
+    // objects may have been added or moved since the snapshot, so check again with a new one
+    FindInIndex(*BuildIndex(parent), parent, name, ret);
+    return ret;
+}
+
+static std::string GetTransformPathImpl(Transform* parent, Transform* child) {
     if (parent == child || !child->IsChildOf(parent))
         return "";
-    auto parents = GetTransformPath(parent, child->parent);
+    auto parents = GetTransformPathImpl(parent, child->parent);
     if (!parents.empty())
         return fmt::format("{}/{}", parents, child->name);
     return child->name;
 }
 
+// returns false if any object on the path has been moved or renamed since the snapshot
+static bool GetPathFromIndex(HierarchyIndex const& index, Transform* child, std::string& result) {
+    auto found = index.indices.find(child);
+    if (found == index.indices.end())
+        return false;
+    result.clear();
+    for (int current = found->second; current > 0; current = index.nodes[current].parent) {
+        auto& node = index.nodes[current];
+        auto& parent = index.nodes[node.parent].transform;
+        if (!node.transform || !parent || node.transform->parent != parent.unsafePtr() || node.transform->name != node.name)
+            return false;
+        result = result.empty() ? node.name : fmt::format("{}/{}", node.name, result);
+    }
+    return true;
+}
+
+std::string MetaCore::Engine::GetTransformPath(TransformWrapper parent, TransformWrapper child) {
+    if (parent == child || !child->IsChildOf(parent))
+        return "";
+    // a single path is cheap to walk, so only use an index if FindRecursive has already built one
+    int id = parent->GetInstanceID();
+    std::string ret;
+    if (hierarchyIndices.contains(id)) {
+        auto index = hierarchyIndices.at(id);
+        if (index && GetPathFromIndex(*index, child, ret))
+            return ret;
+    }
+    return GetTransformPathImpl(parent, child);
+}
+
 void MetaCore::Engine::SetRelativeSiblingIndex(TransformWrapper child, TransformWrapper ref, int amount) {
     // zero won't crash or anything, I just think it's a little confusing in its behavior
     if (amount == 0 || !child->parent || child->parent != ref->parent)
@@ -89,82 +242,462 @@ static Texture2D* GetReadable(Texture2D* texture, Rect bounds) {
     if (texture->isReadable)
         return texture;
 
-    auto ret = Texture2D::New_ctor(bounds.m_Width, bounds.m_Height, texture->format, false, false);
+    // always RGBA32 so that the raw data can be used directly
+    auto ret = Texture2D::New_ctor(bounds.m_Width, bounds.m_Height, TextureFormat::RGBA32, false, false);
 
     auto temp = UnityEngine::RenderTexture::GetTemporary(
         texture->width, texture->height, 0, UnityEngine::RenderTextureFormat::Default, UnityEngine::RenderTextureReadWrite::Default
     );
+    auto active = UnityEngine::RenderTexture::get_active();
     UnityEngine::Graphics::Blit(texture, temp);
     ret->ReadPixels(bounds, 0, 0);
+    UnityEngine::RenderTexture::set_active(active);
     UnityEngine::RenderTexture::ReleaseTemporary(temp);
 
     return ret;
 }
 
-ArrayW<Color> MetaCore::Engine::ScalePixels(Texture2D* texture, int width, int height, Rect bounds) {
-    int origWidth = texture->width;
+// scales on the gpu, halving repeatedly like a mip chain first so that large downscales don't alias
+static RenderTexture* BlitScaled(Texture2D* texture, Rect bounds, int width, int height) {
+    Vector2 scale = {bounds.m_Width / texture->width, bounds.m_Height / texture->height};
+    Vector2 offset = {bounds.m_XMin / texture->width, bounds.m_YMin / texture->height};
+    int currentWidth = bounds.m_Width;
+    int currentHeight = bounds.m_Height;
+
+    auto active = RenderTexture::get_active();
+    UnityEngine::Texture* current = texture;
+    RenderTexture* temp = nullptr;
+    while (currentWidth >= width * 2 || currentHeight >= height * 2) {
+        if (currentWidth >= width * 2)
+            currentWidth /= 2;
+        if (currentHeight >= height * 2)
+            currentHeight /= 2;
+        auto next = RenderTexture::GetTemporary(currentWidth, currentHeight, 0, RenderTextureFormat::ARGB32, RenderTextureReadWrite::Default);
+        Graphics::Blit(current, next, scale, offset);
+        if (temp)
+            RenderTexture::ReleaseTemporary(temp);
+        current = temp = next;
+        scale = {1, 1};
+        offset = {0, 0};
+    }
+    auto ret = RenderTexture::GetTemporary(width, height, 0, RenderTextureFormat::ARGB32, RenderTextureReadWrite::Default);
+    Graphics::Blit(current, ret, scale, offset);
+    if (temp)
+        RenderTexture::ReleaseTemporary(temp);
+    RenderTexture::set_active(active);
+    return ret;
+}
 
+static Texture2D* ReadRenderTexture(RenderTexture* texture) {
+    auto ret = Texture2D::New_ctor(texture->width, texture->height, TextureFormat::RGBA32, false, false);
+    auto active = RenderTexture::get_active();
+    RenderTexture::set_active(texture);
+    ret->ReadPixels(Rect(0, 0, texture->width, texture->height), 0, 0);
+    RenderTexture::set_active(active);
+    ret->Apply();
+    return ret;
+}
+
+static void GetScaledSize(Texture2D* texture, int& width, int& height, Rect& bounds) {
     if (bounds.m_Width <= 0 || bounds.m_Height <= 0)
-        bounds = {0, 0, (float) origWidth, (float) texture->height};
+        bounds = {0, 0, (float) texture->width, (float) texture->height};
 
     if (width <= 0)
         width = bounds.m_Width;
     if (height <= 0)
         height = bounds.m_Height;
+}
 
-    ArrayW<Color> origColors = GetReadable(texture, bounds)->GetPixels();
-    ArrayW<Color> destColors(width * height);
+// copies the pixels within the bounds out of il2cpp on the main thread, so that they can be processed anywhere
+static MetaCore::Image::Buffer ReadPixels(Texture2D* texture, Rect bounds) {
+    auto readable = GetReadable(texture, bounds);
+    int textureWidth = readable->width;
+    int textureHeight = readable->height;
+    // the copy made for unreadable textures only contains the bounds already
+    if (readable != texture)
+        bounds = {0, 0, (float) textureWidth, (float) textureHeight};
+
+    int x = std::clamp((int) std::lround(bounds.m_XMin), 0, textureWidth);
+    int y = std::clamp((int) std::lround(bounds.m_YMin), 0, textureHeight);
+    int width = std::clamp((int) std::lround(bounds.m_Width), 0, textureWidth - x);
+    int height = std::clamp((int) std::lround(bounds.m_Height), 0, textureHeight - y);
+
+    ArrayW<uint8_t> bytes;
+    ArrayW<Color32> pixels;
+    uint8_t const* data;
+    if (readable->format == TextureFormat::RGBA32) {
+        // the first mip level is at the start of the data
+        bytes = readable->GetRawTextureData();
+        data = bytes.begin();
+    } else {
+        pixels = readable->GetPixels32();
+        data = (uint8_t const*) pixels.begin();
+    }
 
-    float ratioX = (texture->width - 1) / (float) width;
-    float ratioY = (texture->height - 1) / (float) height;
+    auto source = MetaCore::Image::View{data, textureWidth, textureHeight, textureWidth * 4}.Crop(x, y, width, height);
+    MetaCore::Image::Buffer ret(width, height);
+    for (int row = 0; row < height; row++)
+        std::memcpy(ret.Row(row), source.Row(row), width * 4);
+    return ret;
+}
 
-    for (int destY = 0; destY < height; destY++) {
-        int origY = (int) destY * ratioY;
-        float yLerp = destY * ratioY - origY;
+static Texture2D* CreateTexture(MetaCore::Image::Buffer const& pixels) {
+    auto ret = Texture2D::New_ctor(pixels.width, pixels.height, TextureFormat::RGBA32, false, false);
+    ArrayW<uint8_t> bytes(pixels.data.size());
+    std::memcpy(bytes.begin(), pixels.data.data(), pixels.data.size());
+    ret->LoadRawTextureData(bytes);
+    ret->Apply();
+    return ret;
+}
 
-        float yIdx1 = origY * origWidth;
-        float yIdx2 = (origY + 1) * origWidth;
-        float yIdxDest = destY * width;
+ArrayW<Color> MetaCore::Engine::ScalePixels(Texture2D* texture, int width, int height, Rect bounds) {
+    GetScaledSize(texture, width, height, bounds);
 
-        for (int destX = 0; destX < width; destX++) {
-            int origX = (int) destX * ratioX;
-            float xLerp = destX * ratioX - origX;
-            destColors[yIdxDest + destX] = Color::Lerp(
-                Color::Lerp(origColors[yIdx1 + origX], origColors[yIdx1 + origX + 1], xLerp),
-                Color::Lerp(origColors[yIdx2 + origX], origColors[yIdx2 + origX + 1], xLerp),
-                yLerp
-            );
+    auto scaled = Image::Scale(ReadPixels(texture, bounds).GetView(), width, height);
+
+    ArrayW<Color> ret(width * height);
+    auto bytes = scaled.data.data();
+    for (auto& color : ret) {
+        color = {bytes[0] / 255.f, bytes[1] / 255.f, bytes[2] / 255.f, bytes[3] / 255.f};
+        bytes += 4;
+    }
+    return ret;
+}
+
+Texture2D* MetaCore::Engine::ScaleTexture(Texture2D* texture, int width, int height, Rect bounds) {
+    GetScaledSize(texture, width, height, bounds);
+
+    return CreateTexture(Image::Scale(ReadPixels(texture, bounds).GetView(), width, height));
+}
+
+// reads back a temporary render texture without stalling, falling back to a synchronous read if unsupported
+static void ReadRenderTextureAsync(RenderTexture* texture, MetaCore::Task<Texture2D*> task) {
+    // only creates the result texture if it is still wanted, since nothing would destroy it otherwise
+    auto finish = [texture, task](auto read) {
+        if (!task.IsCancelled())
+            task.Complete(read());
+        RenderTexture::ReleaseTemporary(texture);
+    };
+
+    if (!SystemInfo::get_supportsAsyncGPUReadback()) {
+        finish([texture]() { return ReadRenderTexture(texture); });
+        return;
+    }
+
+    // unity runs the callback on the main thread once the readback finishes, so nothing has to poll it every frame
+    Rendering::AsyncGPUReadback::Request(
+        texture,
+        0,
+        TextureFormat::RGBA32,
+        MetaCore::Delegates::MakeSystemAction([texture, finish](Rendering::AsyncGPUReadbackRequest request) {
+            if (request.hasError) {
+                logger.warn("async gpu readback failed, reading synchronously");
+                finish([texture]() { return ReadRenderTexture(texture); });
+                return;
+            }
+            finish([texture, &request]() {
+                auto data = request.GetData<uint8_t>(0);
+                MetaCore::Image::Buffer pixels(texture->width, texture->height);
+                std::memcpy(pixels.data.data(), data.m_Buffer, std::min<size_t>(data.m_Length, pixels.data.size()));
+                return CreateTexture(pixels);
+            });
+        })
+    );
+}
+
+MetaCore::Task<Texture2D*> MetaCore::Engine::ReadTextureAsync(Texture2D* texture, Rect bounds) {
+    int width = 0;
+    int height = 0;
+    GetScaledSize(texture, width, height, bounds);
+
+    Task<Texture2D*> ret;
+    ReadRenderTextureAsync(BlitScaled(texture, bounds, width, height), ret);
+    return ret;
+}
+
+MetaCore::Task<Texture2D*> MetaCore::Engine::ScaleTextureAsync(Texture2D* texture, int width, int height, Rect bounds) {
+    GetScaledSize(texture, width, height, bounds);
+
+    Task<Texture2D*> ret;
+    // the pixels would have to be copied from the gpu anyway, so skip the cpu entirely
+    if (!texture->isReadable) {
+        ReadRenderTextureAsync(BlitScaled(texture, bounds, width, height), ret);
+        return ret;
+    }
+
+    auto pixels = std::make_shared<Image::Buffer>(ReadPixels(texture, bounds));
+    RunInBackground(
+        [ret, pixels, width, height]() {
+            if (!ret.IsCancelled())
+                *pixels = Image::Scale(pixels->GetView(), width, height);
+        },
+        [ret, pixels]() {
+            if (!ret.IsCancelled())
+                ret.Complete(CreateTexture(*pixels));
         }
+    );
+    return ret;
+}
+
+namespace {
+    struct PendingWrite {
+        MetaCore::Image::Buffer pixels;
+        std::string file;
+        bool placeholder;
+        MetaCore::Task<bool> task;
+        bool success = false;
+    };
+}
+
+static std::atomic_int pngCompression = 6;
+// only accessed on the main thread, with writes queued during a batch being written in the next one
+static std::vector<PendingWrite> pendingWrites;
+static bool writingBatch = false;
+
+// claims the name right away so that UniqueFileName won't return it again before the write finishes
+static bool CreatePlaceholder(std::string const& file) {
+    if (std::filesystem::exists(file))
+        return false;
+    std::ofstream(file, std::ios::binary);
+    return true;
+}
+
+static bool WriteFileAtomic(std::string const& file, std::string const& data) {
+    // next to the destination so that the rename stays on the same filesystem
+    std::string temp = file + ".tmp";
+    std::ofstream stream(temp, std::ios::binary | std::ios::trunc);
+    stream.write(data.data(), data.size());
+    stream.close();
+    std::error_code error;
+    if (!stream) {
+        std::filesystem::remove(temp, error);
+        return false;
     }
+    std::filesystem::rename(temp, file, error);
+    return !error;
+}
 
-    return destColors;
+static void WritePendingTextures() {
+    if (writingBatch || pendingWrites.empty())
+        return;
+    writingBatch = true;
+
+    auto batch = std::make_shared<std::vector<PendingWrite>>(std::move(pendingWrites));
+    pendingWrites.clear();
+    int level = pngCompression;
+
+    MetaCore::Engine::RunInBackground(
+        [batch, level]() {
+            for (auto& write : *batch) {
+                if (!write.task.IsCancelled()) {
+                    try {
+                        // unity pixel rows go from bottom to top
+                        auto png = MetaCore::Image::EncodePNG(write.pixels.GetView().Flipped(), level);
+                        write.success = !png.empty() && WriteFileAtomic(write.file, png);
+                    } catch (std::exception const& e) {
+                        logger.error("exception writing texture {}: {}", write.file, e.what());
+                    } catch (...) {
+                        logger.error("unknown exception writing texture {}", write.file);
+                    }
+                }
+                if (!write.success && write.placeholder) {
+                    std::error_code error;
+                    std::filesystem::remove(write.file, error);
+                }
+                write.pixels = {};
+            }
+        },
+        [batch]() {
+            writingBatch = false;
+            for (auto& write : *batch) {
+                if (!write.success)
+                    logger.warn("failed to write texture {}", write.file);
+                write.task.Complete(write.success);
+            }
+            WritePendingTextures();
+        }
+    );
 }
 
-Texture2D* MetaCore::Engine::ScaleTexture(Texture2D* texture, int width, int height, Rect bounds) {
-    auto pixels = ScalePixels(texture, width, height, bounds);
-    auto ret = Texture2D::New_ctor(width, height, TextureFormat::RGBA32, false, false);
-    ret->SetPixels(pixels);
-    ret->Apply();
+static void QueueWrite(MetaCore::Image::Buffer pixels, std::string file, bool placeholder, MetaCore::Task<bool> task) {
+    pendingWrites.emplace_back(std::move(pixels), std::move(file), placeholder, std::move(task));
+    // wait for the rest of the frame so that multiple writes can be done in one batch
+    if (pendingWrites.size() == 1)
+        MetaCore::Engine::ScheduleMainThread(WritePendingTextures);
+}
+
+MetaCore::Task<bool> MetaCore::Engine::WriteTexture(Texture2D* texture, std::string file, Rect bounds) {
+    Task<bool> ret;
+    bool placeholder = CreatePlaceholder(file);
+
+    if (texture->isReadable) {
+        QueueWrite(ReadPixels(texture, bounds), std::move(file), placeholder, ret);
+        return ret;
+    }
+
+    ReadTextureAsync(texture, bounds).Then([file = std::move(file), placeholder, ret](Texture2D* readable) {
+        QueueWrite(ReadPixels(readable, Rect(0, 0, readable->width, readable->height)), file, placeholder, ret);
+        Object::Destroy(readable);
+    });
     return ret;
 }
 
-void MetaCore::Engine::WriteTexture(Texture2D* texture, std::string file, Rect bounds) {
-    auto bytes = ImageConversion::EncodeToPNG(GetReadable(texture, bounds));
-    writefile(file, std::string((char*) bytes.begin(), bytes->get_Length()));
+MetaCore::Task<bool> MetaCore::Engine::WriteSprite(Sprite* sprite, std::string file) {
+    return WriteTexture(sprite->texture, file, sprite->textureRect);
 }
 
-void MetaCore::Engine::WriteSprite(Sprite* sprite, std::string file) {
-    WriteTexture(sprite->texture, file, sprite->textureRect);
+void MetaCore::Engine::SetPNGCompression(int level) {
+    pngCompression = std::clamp(level, 0, 9);
 }
 
 void MetaCore::Engine::ScheduleMainThread(std::function<void()> callback) {
     MainThreadScheduler::Schedule(std::move(callback));
 }
 
+void MetaCore::Engine::ScheduleMainThread(std::function<void()> callback, Priority priority) {
+    MainThreadScheduler::Schedule(std::move(callback), priority);
+}
+
 void MetaCore::Engine::ScheduleMainThread(std::function<bool()> wait, std::function<void()> callback) {
     MainThreadScheduler::Schedule(std::move(wait), std::move(callback));
 }
 
+void MetaCore::Engine::SetMainThreadBudget(float milliseconds) {
+    MainThreadScheduler::SetBudget(milliseconds);
+}
+
+float MetaCore::Engine::GetMainThreadDeferral() {
+    return MainThreadScheduler::GetDeferral();
+}
+
+// leaves the little cores alone, along with one big core each for the unity main and render threads
+static int GetWorkerCount() {
+    int cores = std::thread::hardware_concurrency();
+    std::vector<long> maxFrequencies;
+    for (int i = 0; i < cores; i++) {
+        std::ifstream file(fmt::format("/sys/devices/system/cpu/cpu{}/cpufreq/cpuinfo_max_freq", i));
+        long frequency;
+        if (file >> frequency)
+            maxFrequencies.emplace_back(frequency);
+    }
+    int bigCores = cores / 2;
+    if (!maxFrequencies.empty()) {
+        long little = *std::min_element(maxFrequencies.begin(), maxFrequencies.end());
+        int count = std::count_if(maxFrequencies.begin(), maxFrequencies.end(), [little](long frequency) { return frequency > little; });
+        if (count > 0)
+            bigCores = count;
+    }
+    return std::max(bigCores - 2, 1);
+}
+
+struct ThreadPool {
+    ThreadPool(int size) {
+        for (int i = 0; i < size; i++)
+            queues.emplace_back(std::make_unique<Queue>());
+        for (int i = 0; i < size; i++)
+            std::thread(&ThreadPool::Run, this, i).detach();
+        logger.info("started {} worker threads", size);
+    }
+
+    void Push(std::function<void()> task) {
+        // keep tasks queued from a worker on that worker, otherwise spread them out
+        int index = currentWorker >= 0 ? currentWorker : next++ % queues.size();
+        auto& queue = *queues[index];
+        std::unique_lock lock(queue.mutex);
+        queue.tasks.emplace_back(std::move(task));
+        lock.unlock();
+        queued++;
+        // lock to avoid a wakeup being missed between a worker checking and waiting
+        sleepMutex.lock();
+        sleepMutex.unlock();
+        wake.notify_one();
+    }
+
+   private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::atomic_uint next = 0;
+    std::atomic_int queued = 0;
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+
+    static thread_local inline int currentWorker = -1;
+
+    bool Pop(int self, std::function<void()>& task) {
+        for (int i = 0; i < queues.size(); i++) {
+            auto& queue = *queues[(self + i) % queues.size()];
+            std::unique_lock lock(queue.mutex);
+            if (queue.tasks.empty())
+                continue;
+            // newest first from our own queue, oldest first when stealing
+            if (i == 0) {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+            } else {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+            }
+            queued--;
+            return true;
+        }
+        return false;
+    }
+
+    void Run(int self) {
+        currentWorker = self;
+        pthread_setname_np(pthread_self(), "MetaCoreWorker");
+
+        // attach up front instead of in the middle of the first task that uses java
+        MetaCore::Java::GetEnv();
+
+        while (true) {
+            std::function<void()> task;
+            if (Pop(self, task)) {
+                try {
+                    task();
+                } catch (std::exception const& e) {
+                    logger.error("exception in background task: {}", e.what());
+                } catch (...) {
+                    logger.error("unknown exception in background task");
+                }
+                continue;
+            }
+            std::unique_lock lock(sleepMutex);
+            wake.wait(lock, [this]() { return queued > 0; });
+        }
+    }
+};
+
+// intentionally never destroyed, workers run for the lifetime of the game
+static ThreadPool* GetThreadPool() {
+    static ThreadPool* pool = new ThreadPool(GetWorkerCount());
+    return pool;
+}
+
+void MetaCore::Engine::RunInBackground(std::function<void()> task, std::function<void()> continuation) {
+    if (!task)
+        return;
+    GetThreadPool()->Push([task = std::move(task), continuation = std::move(continuation)]() mutable {
+        task();
+        if (continuation)
+            MainThreadScheduler::Schedule(std::move(continuation));
+    });
+}
+
+void MetaCore::Engine::LogCoroutineException(std::exception_ptr exception) {
+    try {
+        std::rethrow_exception(exception);
+    } catch (std::exception const& e) {
+        logger.error("exception in coroutine: {}", e.what());
+    } catch (...) {
+        logger.error("unknown exception in coroutine");
+    }
+}
+
 void MetaCore::Engine::SetOnEnable(TransformWrapper object, std::function<void()> callback, bool once) {
     auto signal = GetOrAddComponent<ObjectSignal*>(object);
     if (once)
@@ -189,8 +722,28 @@ void MetaCore::Engine::SetOnDestroy(TransformWrapper object, std::function<void(
     ObjectSignal::onDestroys[object->gameObject->GetInstanceID()] = callback;
 }
 
-void MetaCore::Engine::ScheduleOnUpdate(std::function<void()> callback) {
-    MainThreadScheduler::AddUpdate(std::move(callback));
+int MetaCore::Engine::ScheduleOnUpdate(std::function<void()> callback) {
+    return MainThreadScheduler::AddUpdate(std::move(callback));
+}
+
+int MetaCore::Engine::ScheduleEveryFrames(std::function<void()> callback, int frames) {
+    return MainThreadScheduler::AddUpdate(std::move(callback), frames);
+}
+
+int MetaCore::Engine::ScheduleAtRate(std::function<void()> callback, float rate) {
+    return MainThreadScheduler::AddUpdate(std::move(callback), 1, rate > 0 ? 1 / rate : 0);
+}
+
+void MetaCore::Engine::RemoveOnUpdate(int id) {
+    MainThreadScheduler::RemoveUpdate(id);
+}
+
+void MetaCore::Engine::SetUpdateTiming(bool enabled) {
+    MainThreadScheduler::SetUpdateTiming(enabled);
+}
+
+std::vector<MetaCore::Engine::UpdateTiming> MetaCore::Engine::GetUpdateTimings() {
+    return MainThreadScheduler::GetUpdateTimings();
 }
 
 // math from https://stackoverflow.com/a/20249699